@@ -323,11 +323,11 @@ static void acpi_madt_setup(sys_info_t *sysinfo, acpi_madt_t *madt)
 
     // Alloc CPUs table
     sysinfo->cpu_count = cpus;
-    sysinfo->cpu_table = kalloc(cpus * sizeof(cpu_info_t));
-    sysinfo->cpu_table->arch = kalloc(cpus * sizeof(x86_cpu_t));
+    sysinfo->cpu_table = kzalloc(cpus * sizeof(cpu_info_t));
+    sysinfo->cpu_table->arch = kzalloc(cpus * sizeof(x86_cpu_t));
     for (int i = 1; i < cpus; ++i)
         sysinfo->cpu_table[i].arch = &sysinfo->cpu_table[0].arch[i];
-    cpu_kstacks = kalloc(cpus * sizeof(size_t));
+    cpu_kstacks = kzalloc(cpus * sizeof(size_t));
 
     // Browser entries
     ptr = madt->records;
@@ -376,9 +376,9 @@ void acpi_setup(sys_info_t *sysinfo)
         kprintf(-1, "Not found ACPI.\n");
         sysinfo->arch->acpi = NULL;
         sysinfo->cpu_count = 1;
-        sysinfo->cpu_table = kalloc(sizeof(cpu_info_t));
-        sysinfo->cpu_table->arch = kalloc(sizeof(x86_cpu_t));
-        cpu_kstacks = kalloc(sizeof(size_t));
+        sysinfo->cpu_table = kzalloc(sizeof(cpu_info_t));
+        sysinfo->cpu_table->arch = kzalloc(sizeof(x86_cpu_t));
+        cpu_kstacks = kzalloc(sizeof(size_t));
         sysinfo->cpu_table->stack = (void *)0x4000;
         cpu_kstacks = (void *)0x4000;
         return;
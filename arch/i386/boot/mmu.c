@@ -57,8 +57,14 @@ void mboot_memory();
 #define PG_BIGPAGE 0x080
 #define PG_GLOBAL 0x100
 
+#define PG_HUGE_MASK  (HUGE_PAGE_SIZE - 1)
+
+#define MMU_TBL_SPAN  (1024 * PAGE_SIZE)
+#define MMU_FLUSH_PAGES  32  /* Above, reloading CR3 is cheaper than invalidating each page */
+
 void setup_allocator(void *ptr, size_t len);
 void x86_set_cr3(size_t cr3);
+int cpu_feature(x86_cpu_t *cpu, const char *feature, int n);
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 
@@ -102,7 +108,7 @@ void mmu_ktables(size_t vaddr)
     size_t i = vaddr >> 22;
     splock_lock(&__ktbl_lock);
     if (((page_t *)0xFFBFF000)[i] == 0)
-        ((page_t *)0xFFBFF000)[i] = page_new() | PG_PRESENT | PG_WRITABLE | PG_GLOBAL;
+        ((page_t *)0xFFBFF000)[i] = page_new_table() | PG_PRESENT | PG_WRITABLE | PG_GLOBAL;
     if (((page_t *)0xFFFFF000)[i] == 0)
         ((page_t *)0xFFFFF000)[i] = ((page_t *)0xFFBFF000)[i];
     splock_unlock(&__ktbl_lock);
@@ -111,7 +117,7 @@ void mmu_ktables(size_t vaddr)
 void mmu_create_uspace(vmsp_t *vmsp)
 {
     unsigned i;
-    page_t dir_pg = page_new();
+    page_t dir_pg = page_new_table();
     page_t *dir = (page_t *)kmap(PAGE_SIZE, NULL, dir_pg, VMA_PHYS | VM_RW);
     memset(dir, 0,  PAGE_SIZE);
     dir[1023] = dir_pg | (PG_PRESENT | PG_WRITABLE | PG_GLOBAL);
@@ -135,9 +141,11 @@ void mmu_destroy_uspace(vmsp_t *vmsp)
     page_t *dir = (page_t *)kmap(PAGE_SIZE, NULL, dir_pg, VMA_PHYS | VM_RW);
 
     for (i = MMU_BOUND_ULOWER >> 22; i < MMU_BOUND_UUPPER >> 22; ++i) {
+        // Huge pages have been split when their pages were dropped
+        assert((dir[i] & PG_BIGPAGE) == 0);
         if (dir[i]) {
             vmsp->p_size--;
-            page_release(dir[i] & (PAGE_SIZE - 1));
+            page_release(dir[i] & ~(PAGE_SIZE - 1));
         }
     }
     kunmap(dir, PAGE_SIZE);
@@ -163,18 +171,80 @@ static int mmu_flags(size_t vaddr, int flags)
 }
 
 
+static void mmu_invlpg(size_t vaddr)
+{
+    asm volatile(
+        "movl %0,%%eax\n"
+        "invlpg (%%eax)\n"
+        :: "r"(vaddr) : "%eax");
+}
+
+/* Replace a huge page by a table of regular pages with the same rights */
+static void mmu_split(size_t vaddr)
+{
+    size_t *dir = MMU_DIR(vaddr);
+    size_t base = *dir & ~PG_HUGE_MASK;
+    int pgf = *dir & (PAGE_SIZE - 1) & ~PG_BIGPAGE;
+    size_t tbl_pg = page_new_table();
+    size_t *tbl = (size_t *)kmap(PAGE_SIZE, NULL, tbl_pg, VMA_PHYS | VM_RW);
+    for (int i = 0; i < 1024; ++i)
+        tbl[i] = (base + i * PAGE_SIZE) | pgf;
+    kunmap(tbl, PAGE_SIZE);
+
+    *dir = tbl_pg | (PG_PRESENT | PG_WRITABLE | PG_USERMODE);
+    mmu_invlpg(ALIGN_DW(vaddr, HUGE_PAGE_SIZE));
+    mmu_invlpg((size_t)MMU_TBL(vaddr));
+    vmsp_t *vmsp = memory_space_at(vaddr);
+    vmsp->h_size--;
+    vmsp->t_size++;
+}
+
+bool mmu_huge_usable(size_t vaddr)
+{
+    // Kernel tables are copied lazily on each directory, we can't split them
+    if (vaddr < MMU_BOUND_ULOWER || vaddr >= MMU_BOUND_UUPPER)
+        return false;
+    sys_info_t *sysinfo = ksys();
+    if (sysinfo->cpu_table == NULL || !cpu_feature(sysinfo->cpu_table[0].arch, "PSE", 3))
+        return false;
+    return *MMU_DIR(vaddr) == 0;
+}
+
+void mmu_resolve_huge(size_t vaddr, size_t phys, int flags)
+{
+    size_t *dir = MMU_DIR(vaddr);
+    assert((vaddr & PG_HUGE_MASK) == 0 && (phys & PG_HUGE_MASK) == 0);
+    assert(*dir == 0);
+    *dir = phys | mmu_flags(vaddr, flags) | PG_BIGPAGE;
+}
+
+size_t mmu_drop_huge(size_t vaddr)
+{
+    size_t *dir = MMU_DIR(vaddr);
+    assert((vaddr & PG_HUGE_MASK) == 0);
+    if ((*dir & 1) == 0 || (*dir & PG_BIGPAGE) == 0)
+        return 0;
+    size_t base = *dir & ~PG_HUGE_MASK;
+    size_t dirty = *dir & PG_DIRTY ? MMU_DIRTY : 0;
+    *dir = 0;
+    memory_space_at(vaddr)->h_size--;
+    mmu_invlpg(vaddr);
+    return base | dirty;
+}
+
 size_t mmu_protect(size_t vaddr, int flags)
 {
     size_t *dir = MMU_DIR(vaddr);
     size_t *tbl = MMU_TBL(vaddr);
-    if ((*dir & 1) == 0 || ((*tbl & 1) == 0))
+    if ((*dir & 1) == 0)
+        return 0;
+    if (*dir & PG_BIGPAGE)
+        mmu_split(vaddr);
+    if ((*tbl & 1) == 0)
         return 0;
     size_t pg = *tbl & ~(PAGE_SIZE - 1);
     *tbl = pg | mmu_flags(vaddr, flags);
-    asm volatile(
-        "movl %0,%%eax\n"
-        "invlpg (%%eax)\n"
-        :: "r"(vaddr) : "%eax");
+    mmu_invlpg(vaddr);
     return pg;
 }
 
@@ -184,7 +254,11 @@ size_t mmu_read(size_t vaddr)
 {
     size_t *dir = MMU_DIR(vaddr);
     size_t *tbl = MMU_TBL(vaddr);
-    if ((*dir & 1) == 0 || ((*tbl & 1) == 0))
+    if ((*dir & 1) == 0)
+        return 0;
+    if (*dir & PG_BIGPAGE)
+        return (*dir & ~PG_HUGE_MASK) | (vaddr & PG_HUGE_MASK & ~(PAGE_SIZE - 1));
+    if ((*tbl & 1) == 0)
         return 0;
     return *tbl & ~(PAGE_SIZE - 1);
 }
@@ -196,19 +270,119 @@ size_t mmu_drop(size_t vaddr)
     // kprintf(-1, " - %08x\n", vaddr);
     size_t *dir = MMU_DIR(vaddr);
     size_t *tbl = MMU_TBL(vaddr);
-    if ((*dir & 1) == 0 || ((*tbl & 1) == 0))
+    if ((*dir & 1) == 0)
+        return 0;
+    if (*dir & PG_BIGPAGE)
+        mmu_split(vaddr);
+    if ((*tbl & 1) == 0)
         return 0;
     size_t pg = *tbl & ~(PAGE_SIZE - 1);
     // if (vaddr < 0x500000)
     //     kprintf(-1, "[MMU] Drop page at %p using %p {%p.%p}\n", vaddr, pg, cr3, tbl);
     *tbl = 0;
-    asm volatile(
-        "movl %0,%%eax\n"
-        "invlpg (%%eax)\n"
-        :: "r"(vaddr) : "%eax");
+    mmu_invlpg(vaddr);
     return pg;
 }
 
+/* Invalidate the TLB entries of a range whose entries have all been updated */
+static void mmu_flush_range(size_t vaddr, size_t length)
+{
+    size_t address;
+    // Kernel pages are global and survive a CR3 reload
+    if (length / PAGE_SIZE > MMU_FLUSH_PAGES && vaddr >= MMU_BOUND_ULOWER && vaddr + length <= MMU_BOUND_UUPPER) {
+        x86_set_cr3(__mmu.uspace->directory);
+        return;
+    }
+    for (address = vaddr; address < vaddr + length; address += PAGE_SIZE)
+        mmu_invlpg(address);
+}
+
+/* Huge pages are kept if the range covers them, split otherwise */
+static bool mmu_range_huge(size_t vaddr, size_t limit)
+{
+    size_t base = ALIGN_DW(vaddr, HUGE_PAGE_SIZE);
+    if (base >= vaddr && limit - base >= HUGE_PAGE_SIZE)
+        return true;
+    mmu_split(vaddr);
+    return false;
+}
+
+size_t mmu_protect_range(size_t vaddr, size_t length, int flags)
+{
+    size_t count = 0;
+    size_t limit = vaddr + length;
+    size_t address = vaddr;
+    while (address < limit) {
+        size_t next = MIN(ALIGN_DW(address, MMU_TBL_SPAN) + MMU_TBL_SPAN, limit);
+        size_t *dir = MMU_DIR(address);
+        if ((*dir & 1) == 0) {
+            address = next;
+            continue;
+        }
+        if ((*dir & PG_BIGPAGE) && mmu_range_huge(address, limit)) {
+            *dir = (*dir & ~PG_HUGE_MASK) | mmu_flags(address, flags) | PG_BIGPAGE;
+            count += HUGE_PAGE_PAGES;
+            address = next;
+            continue;
+        }
+        for (; address < next; address += PAGE_SIZE) {
+            size_t *tbl = MMU_TBL(address);
+            if (*tbl & 1) {
+                *tbl = (*tbl & ~(PAGE_SIZE - 1)) | mmu_flags(address, flags);
+                count++;
+            }
+        }
+    }
+    mmu_flush_range(vaddr, length);
+    return count;
+}
+
+size_t mmu_drop_range(size_t vaddr, size_t length, size_t *pages)
+{
+    int i;
+    size_t tables = 0;
+    size_t limit = vaddr + length;
+    size_t address = vaddr;
+    while (address < limit) {
+        size_t next = MIN(ALIGN_DW(address, MMU_TBL_SPAN) + MMU_TBL_SPAN, limit);
+        size_t *dir = MMU_DIR(address);
+        if ((*dir & 1) == 0) {
+            for (; address < next; address += PAGE_SIZE)
+                *(pages++) = 0;
+            continue;
+        }
+        if ((*dir & PG_BIGPAGE) && mmu_range_huge(address, limit)) {
+            size_t base = *dir & ~PG_HUGE_MASK;
+            size_t dirty = *dir & PG_DIRTY ? MMU_DIRTY : 0;
+            for (i = 0; i < HUGE_PAGE_PAGES; ++i)
+                *(pages++) = (base + i * PAGE_SIZE) | dirty;
+            *dir = 0;
+            memory_space_at(address)->h_size--;
+            address = next;
+            continue;
+        }
+        size_t start = address;
+        for (; address < next; address += PAGE_SIZE) {
+            size_t *tbl = MMU_TBL(address);
+            size_t pg = *tbl & 1 ? *tbl & ~(PAGE_SIZE - 1) : 0;
+            *(pages++) = pg != 0 && (*tbl & PG_DIRTY) ? pg | MMU_DIRTY : pg;
+            *tbl = 0;
+        }
+        // Kernel tables are shared by all directories and are never released
+        if (start >= MMU_BOUND_KLOWER)
+            continue;
+        size_t *tbl = MMU_TBL(ALIGN_DW(start, MMU_TBL_SPAN));
+        for (i = 0; i < 1024 && tbl[i] == 0; ++i);
+        if (i == 1024) {
+            page_release(*dir & ~(PAGE_SIZE - 1));
+            *dir = 0;
+            mmu_invlpg((size_t)tbl);
+            tables++;
+        }
+    }
+    mmu_flush_range(vaddr, length);
+    return tables;
+}
 
 size_t mmu_set(size_t directory, size_t vaddr, size_t phys, int flags)
 {
@@ -222,19 +396,20 @@ size_t mmu_resolve(size_t vaddr, size_t phys, int flags)
     // size_t cr3 = x86_get_cr3();
     size_t *dir = MMU_DIR(vaddr);
     size_t *tbl = MMU_TBL(vaddr);
+    assert((*dir & PG_BIGPAGE) == 0);
     if (*dir == 0) {
         if (vaddr >= MMU_BOUND_KLOWER) {
             size_t *krn = MMU_KRN(vaddr);
             if (*krn == 0) {
                 pages++;
-                *krn = page_new() | (PG_PRESENT | PG_WRITABLE | PG_GLOBAL);
+                *krn = page_new_table() | (PG_PRESENT | PG_WRITABLE | PG_GLOBAL);
                 *dir = *krn;
                 memset((void *)ALIGN_DW((size_t)tbl, PAGE_SIZE), 0, PAGE_SIZE);
             }
             *dir = *krn;
         } else {
             pages++;
-            size_t pgd = page_new();
+            size_t pgd = page_new_table();
             *dir = pgd | (PG_PRESENT | PG_WRITABLE | PG_USERMODE);
             // if (vaddr < 0x500000)
             //     kprintf(-1, "[MMU] Missing table %p using %p {%p.%p}\n", vaddr, pgd, cr3, dir);
@@ -245,7 +420,7 @@ size_t mmu_resolve(size_t vaddr, size_t phys, int flags)
     if (*tbl == 0) {
         if (phys == 0) {
             pages++;
-            phys = page_new();
+            phys = page_new_table();
         }
         // if (vaddr < 0x500000)
         //     kprintf(-1, "[MMU] Resolve at %p using %p {%p.%p}\n", vaddr, phys, cr3, tbl);
@@ -261,6 +436,23 @@ bool mmu_dirty(size_t vaddr)
     return false;
 }
 
+bool mmu_young(size_t vaddr)
+{
+    size_t *entry = MMU_DIR(vaddr);
+    if ((*entry & 1) == 0)
+        return false;
+    if ((*entry & PG_BIGPAGE) == 0) {
+        entry = MMU_TBL(vaddr);
+        if ((*entry & 1) == 0)
+            return false;
+    }
+    // The CPU might set the dirty bit meanwhile
+    if ((__atomic_fetch_and(entry, ~PG_ACCESSED, __ATOMIC_SEQ_CST) & PG_ACCESSED) == 0)
+        return false;
+    mmu_invlpg(vaddr);
+    return true;
+}
+
 /* - */
 int mmu_read_flags(size_t vaddr)
 {
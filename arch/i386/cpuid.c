@@ -77,6 +77,12 @@ void cpuid_setup(sys_info_t *sysinfo)
     cpu->features[0] = cpu_res[2];
     cpu->features[1] = cpu_res[3];
 
+    // Allow 4 Mb pages on this CPU (CR4.PSE)
+    if (cpu_feature(cpu, "PSE", 3))
+        asm volatile("movl %%cr4, %%eax\n"
+                     "orl $0x10, %%eax\n"
+                     "movl %%eax, %%cr4\n" ::: "%eax");
+
     // Display CPU info
     int lg = 0;
     char tmp[512];
@@ -27,7 +27,7 @@ ext2_dir_iter_t *ext2_opendir(inode_t *dir)
     assert(dir->type == FL_DIR);
 
     ext2_volume_t *vol = (ext2_volume_t *)dir->drv_data;
-    ext2_dir_iter_t *iter = kalloc(sizeof(ext2_dir_iter_t));
+    ext2_dir_iter_t *iter = kzalloc(sizeof(ext2_dir_iter_t));
 
     iter->entry = ext2_entry(&iter->bk, vol, dir->no, VM_RD);
     ext2_iterator_open(vol, iter->entry, &iter->it, false, VM_RD);
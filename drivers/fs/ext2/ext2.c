@@ -669,7 +669,7 @@ ino_ops_t ext2_lnk_ops = {
 
 inode_t* ext2_mount(inode_t* dev, const char* options)
 {
-    ext2_volume_t* vol = kalloc(sizeof(ext2_volume_t));
+    ext2_volume_t* vol = kzalloc(sizeof(ext2_volume_t));
 
     uint8_t* ptr = kmap(PAGE_SIZE, dev, 0, VM_RD);
     if (ptr == NULL) {
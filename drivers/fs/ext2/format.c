@@ -161,7 +161,7 @@ int ext2_format(inode_t* dev, const char* options)
     uint32_t timestamp = (uint32_t)(xtime_read(XTIME_CLOCK) / 1000000UL);
 
     // Prepare super block !
-    ext2_sb_t* sb = kalloc(1024);
+    ext2_sb_t* sb = kzalloc(1024);
     // memset(sb, 0, sizeof(ext2_sb_t));
     sb->magic = EXT2_SUPER_MAGIC;
     sb->rev_level = EXT2_DYNAMIC_REV;
@@ -195,7 +195,7 @@ int ext2_format(inode_t* dev, const char* options)
 
 
     uint32_t grp_full_size = grp_desc_blocks * block_size;
-    ext2_grp_t* gd = kalloc(grp_full_size);
+    ext2_grp_t* gd = kzalloc(grp_full_size);
     uint32_t free_blocks_count = 0;
     for (i = 0, pos = dc, n = nbr_blocks; i < ngroup; ++i, pos += blocks_per_group, n -= blocks_per_group) {
 
@@ -258,7 +258,7 @@ int ext2_format(inode_t* dev, const char* options)
     }
 
     // Root directory
-    ext2_ino_t* ino = kalloc(sizeof(ext2_ino_t));
+    ext2_ino_t* ino = kzalloc(sizeof(ext2_ino_t));
     ino->mode = EXT2_S_IFDIR | 0755;
     ino->mtime = timestamp;
     ino->atime = timestamp;
@@ -284,7 +284,7 @@ int ext2_format(inode_t* dev, const char* options)
 
 
     // lost+found content 2nd+ block
-    ext2_dir_hack_t* dir = kalloc(block_size);
+    ext2_dir_hack_t* dir = kzalloc(block_size);
     dir->rec_len1 = block_size;
     for (i = 1; i < lost_and_found_block; ++i) {
         ptr = bkmap(&bm, gd[0].inode_table + inode_table_blocks + 1 + i, block_size, 0, dev, VM_RW);
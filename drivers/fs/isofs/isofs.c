@@ -116,7 +116,7 @@ void isofs_close(inode_t *ino)
 
 xoff_t *isofs_opendir(inode_t *dir)
 {
-    xoff_t *poffset = kalloc(sizeof(xoff_t));
+    xoff_t *poffset = kzalloc(sizeof(xoff_t));
     errno = 0;
     return poffset;
 }
@@ -133,7 +133,7 @@ int isofs_closedir(inode_t *dir, xoff_t *poffset)
 
 inode_t *isofs_lookup(inode_t *dir, const char *name, void *acl)
 {
-    char *filename = kalloc(256);
+    char *filename = kzalloc(256);
     xoff_t offset = 0;
     struct bkmap bk;
     void *ptr = NULL;
@@ -247,7 +247,7 @@ inode_t *isofs_mount(inode_t *dev, const char *options)
                 errno = EBADF;
                 return NULL;
             }
-            info = (struct ISO_info *)kalloc(sizeof(struct ISO_info));
+            info = (struct ISO_info *)kzalloc(sizeof(struct ISO_info));
             info->bootable = false;
             info->created = 0;
             info->sectorSize = descriptor->logicBlockSizeLE;
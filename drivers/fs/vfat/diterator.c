@@ -187,7 +187,7 @@ inode_t *fat_open(inode_t *dir, const char *name, ftype_t type, void *acl, int f
 
 void *fat_opendir(inode_t *dir)
 {
-    fat_iterator_t *ctx = kalloc(sizeof(fat_iterator_t));
+    fat_iterator_t *ctx = kzalloc(sizeof(fat_iterator_t));
     fat_create_iterator(dir, ctx);
     return ctx;
 }
@@ -28,7 +28,7 @@ FAT_volume_t *fatfs_init(void *ptr)
                                         bpb->BS_jmpBoot[2] == 0x90))
         return NULL;
 
-    FAT_volume_t *info = (FAT_volume_t *)kalloc(sizeof(FAT_volume_t));
+    FAT_volume_t *info = (FAT_volume_t *)kzalloc(sizeof(FAT_volume_t));
     info->RootDirSectors = ((bpb->BPB_RootEntCnt * 32) + (bpb->BPB_BytsPerSec - 1)) / bpb->BPB_BytsPerSec;
     info->FATSz = (bpb->BPB_FATSz16 != 0 ? bpb->BPB_FATSz16 : bpb32->BPB_FATSz32);
     info->FirstDataSector = bpb->BPB_ResvdSecCnt + (bpb->BPB_NumFATs * info->FATSz) + info->RootDirSectors;
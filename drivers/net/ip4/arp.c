@@ -142,7 +142,7 @@ int arp_receive(skb_t *skb)
         }
     }
 
-    kfree(skb);
+    net_skb_free(skb);
     return 0;
 }
 
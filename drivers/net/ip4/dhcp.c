@@ -126,7 +126,7 @@ static dhcp_info_t *dhcp_readinfo(ifnet_t *ifnet)
     assert(ipinfo != NULL);
     dhcp_info_t *info = ipinfo->dhcp;
     if (info == NULL) {
-        info = kalloc(sizeof(dhcp_info_t));
+        info = kzalloc(sizeof(dhcp_info_t));
         info->mode = 0;
         info->last_request = 0;
         splock_init(&info->lock);
@@ -363,7 +363,7 @@ static void dhcp_on_discovery(ifnet_t *net, dhcp_msg_t *msg)
 
 
     // If not create a lease on new IP
-    lease = kalloc(sizeof(dhcp_lease_t));
+    lease = kzalloc(sizeof(dhcp_lease_t));
     memcpy(lease->ip, ip4->subnet.address, IP4_ALEN);
     lease->ip[3] = idx + 4;
     lease->expired = xtime_read(XTIME_CLOCK) + SEC_TO_USEC(DHCP_LEASE_DURATION);
@@ -531,7 +531,7 @@ int dhcp_receive(skb_t *skb, int length)
     }
 
     dhcp_clean_msg(&msg);
-    kfree(skb);
+    net_skb_free(skb);
     return 0;
 }
 
@@ -136,7 +136,7 @@ int icmp_receive(skb_t *skb, unsigned length)
         }
     }
 
-    kfree(skb);
+    net_skb_free(skb);
     return 0;
 }
 
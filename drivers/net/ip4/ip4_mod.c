@@ -82,7 +82,7 @@ ip4_info_t *ip4_readinfo(ifnet_t *ifnet)
     splock_lock(&master->lock);
     ip4_info_t *info = hmp_get(&master->ifinfos, key, lg);
     if (info == NULL) {
-        info = kalloc(sizeof(ip4_info_t));
+        info = kzalloc(sizeof(ip4_info_t));
         info->ttl = 128;
         info->use_dhcp = true;
         /*memset(info->broadcast.ip, 0xff, IP4_ALEN);
@@ -221,8 +221,8 @@ int ip4_start(netstack_t *stack)
     if (proto != NULL)
         return -1;
 
-    proto = kalloc(sizeof(nproto_t));
-    ip4_master_t *master = kalloc(sizeof(ip4_master_t));
+    proto = kzalloc(sizeof(nproto_t));
+    ip4_master_t *master = kzalloc(sizeof(ip4_master_t));
     splock_init(&master->plock);
     splock_init(&master->lock);
     splock_init(&master->rlock);
@@ -234,11 +234,11 @@ int ip4_start(netstack_t *stack)
     proto->teardown = ip4_teardown_stack;
     net_set_protocol(stack, NET_AF_IP4, proto);
 
-    nproto_t *proto_tcp = kalloc(sizeof(nproto_t));
+    nproto_t *proto_tcp = kzalloc(sizeof(nproto_t));
     tcp_proto(proto_tcp);
     net_set_protocol(stack, NET_AF_TCP, proto_tcp);
 
-    nproto_t *proto_udp = kalloc(sizeof(nproto_t));
+    nproto_t *proto_udp = kzalloc(sizeof(nproto_t));
     udp_proto(proto_udp);
     net_set_protocol(stack, NET_AF_UDP, proto_udp);
 
@@ -40,7 +40,7 @@ int ip4_socket_bind(ip4_master_t *master, bbtree_t *tree, socket_t *sock, const
     int ipclass = ip4_identify(addr);
     if (ipclass < 0)
         return -1;
-    ip4_port_t *nport = kalloc(sizeof(ip4_port_t));
+    ip4_port_t *nport = kzalloc(sizeof(ip4_port_t));
     uint16_t port = ntohs(*((uint16_t *)&addr[4]));
 
     // Looking for the port
@@ -66,7 +66,7 @@ int ip4_socket_bind(ip4_master_t *master, bbtree_t *tree, socket_t *sock, const
 /* Look for an ephemeral port on UDP or TCP */
 uint16_t ip4_ephemeral_port(ip4_master_t *master, bbtree_t *tree, socket_t *sock)
 {
-    ip4_port_t *nport = kalloc(sizeof(ip4_port_t));
+    ip4_port_t *nport = kzalloc(sizeof(ip4_port_t));
 
     // Looking for the next ephemeral port
     splock_lock(&master->plock);
@@ -217,12 +217,12 @@ long udp_socket_recv(socket_t* sock, uint8_t* addr, char* buf, size_t len, int f
         unsigned lg = skb->length - skb->pen;
         void *ptr = net_skb_reserve(skb, lg);
         if (len < lg) {
-            kfree(skb);
+            net_skb_free(skb);
             return -1;
         }
         memcpy(buf, ptr, lg);
         // Can we continue!?
-        kfree(skb);
+        net_skb_free(skb);
         return lg;
     }
     // Wait for recv packet (sleep on sock->incm - may be use a semaphore !?);
@@ -242,7 +242,7 @@ int udp_socket_close(socket_t *sock)
     // Trash all unprocessed rx packet 
     while (sock->lskb.count_ > 0) {
         skb_t *skb = ll_dequeue(&sock->lskb, skb_t, node);
-        kfree(skb);
+        net_skb_free(skb);
     }
 
     return 0;
@@ -469,7 +469,7 @@ void e1000_tx_init(e1000_device_t *ifnet)
 void e1000_startup(struct PCI_device *pci, const char *name)
 {
     int i;
-    e1000_device_t *ifnet = (e1000_device_t *)kalloc(sizeof(e1000_device_t));
+    e1000_device_t *ifnet = (e1000_device_t *)kzalloc(sizeof(e1000_device_t));
 
     ifnet->pci = pci;
     ifnet->name = strdup(name);
@@ -188,7 +188,7 @@ void vga_start_qemu(struct PCI_device *pci, struct device_id *devinfo)
     ino->dev->model = strdup(devinfo->name);
     ino->dev->devclass = strdup("VGA Screen");
 
-    vga_info_t *info = kalloc(sizeof(vga_info_t));
+    vga_info_t *info = kzalloc(sizeof(vga_info_t));
     ino->drv_data = info;
     info->pci = pci;
     info->width = screen_size[i * 2];
@@ -0,0 +1,33 @@
+/*
+ *      This file is part of the KoraOS project.
+ *  Copyright (C) 2015-2021  <Fabien Bavent>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   - - - - - - - - - - - - - - -
+ */
+#ifndef _KERNEL_KPROF_H
+#define _KERNEL_KPROF_H 1
+
+#include <kernel/stdc.h>
+
+/* Default sampling period, one allocation out of KPROF_RATE is recorded */
+#define KPROF_RATE  16
+
+void kprof_setup(int rate);
+void kprof_alloc(void *ptr, size_t len, const char *site);
+void kprof_free(void *ptr);
+int kprof_report(char *buf, size_t len);
+
+#endif /* _KERNEL_KPROF_H */
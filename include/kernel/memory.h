@@ -23,7 +23,10 @@
 #include <kernel/stdc.h>
 #include <kora/bbtree.h>
 #include <kora/splock.h>
+#include <kora/rwlock.h>
+#include <sys/rwsem.h>
 #include <kora/hmap.h>
+#include <kora/llist.h>
 // #include <kernel/arch.h>
 // #include <kernel/vma.h>
 
@@ -34,6 +37,9 @@ enum {
     VMA_FIXED = 0x40000,
     VMA_CLEAN = 0x80000,
     VMA_BACKEDUP = 0x100000,
+    VMA_SEQUENTIAL = 0x200000,
+    VMA_RANDOM = 0x400000,
+    VMA_MERGEABLE = 0x800000,
 
     VMA_HEAP = 0x1000,
     VMA_STACK = 0x2000,
@@ -50,9 +56,22 @@ enum {
     VMA_TYPE = 0xF000,
 };
 
+/* Access hints, values follow the MADV_* constants */
+enum {
+    VMA_ADV_NORMAL = 0,
+    VMA_ADV_RANDOM,
+    VMA_ADV_SEQUENTIAL,
+    VMA_ADV_WILLNEED,
+    VMA_ADV_DONTNEED,
+    VMA_ADV_MERGEABLE = 12,
+    VMA_ADV_UNMERGEABLE,
+};
+
 #define VM_UNMAPED 0x40000
 #define VM_FAST_ALLOC 0400
 
+#define MMU_DIRTY 1  /* Set on pages returned by mmu_drop_range() which have been written */
+
 #define VPG_BACKEDUP 0
 #define VPG_SHARED 1
 #define VPG_PRIVATE 2
@@ -66,23 +85,41 @@ typedef struct task task_t;
 typedef struct vma vma_t;
 typedef struct vmsp vmsp_t;
 typedef struct vma_ops vma_ops_t;
-typedef struct page_sharing page_sharing_t;
+typedef struct page_frame page_frame_t;
 
 
 ///* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
+/* Hold the space for faults, the caller might sleep on a user space */
+void vmsp_rdlock(vmsp_t *vmsp);
+void vmsp_rdunlock(vmsp_t *vmsp);
+/* Hold the space exclusively, faults that slept meanwhile will retry */
+void vmsp_lock(vmsp_t *vmsp);
+void vmsp_unlock(vmsp_t *vmsp);
+bool vmsp_locked(vmsp_t *vmsp);
+
+/* Look for the area holding an address, the caller holds the space lock */
 vma_t *vmsp_find_area(vmsp_t *vmsp, size_t address);
 size_t vmsp_map(vmsp_t *vmsp, size_t address, size_t length, void *ptr, xoff_t offset, int flags);
 int vmsp_unmap(vmsp_t *vmsp, size_t base, size_t length);
 int vmsp_protect(vmsp_t *vmsp, size_t base, size_t length, int flags);
+/* Apply an access hint (VMA_ADV_*) on a range of the address space */
+int vmsp_advise(vmsp_t *vmsp, size_t base, size_t length, int advice);
 
 vmsp_t *vmsp_create();
 vmsp_t *vmsp_open(vmsp_t *vmsp);
 vmsp_t *vmsp_clone(vmsp_t *vmsp);
 void vmsp_sweep(vmsp_t *vmsp);
 void vmsp_close(vmsp_t *vmsp);
+/* Walk the user spaces, the returned one stays open until the next call */
+vmsp_t *vmsp_next(vmsp_t *vmsp);
 
 int vmsp_resolve(vmsp_t *vmsp, size_t address, bool missing, bool write);
 void vmsp_display(vmsp_t *vmsp);
+int vmsp_evict(vmsp_t *vmsp, int count);
+/* Look for identical pages on the mergeable areas */
+int vmsp_merge(vmsp_t *vmsp);
+/* Keep on the VMA tree the largest free gap of each subtree */
+void vma_augment(bbnode_t *node, bbnode_t *left, bbnode_t *right);
 
 vmsp_t *memory_space_at(size_t address);
 
@@ -109,14 +146,48 @@ vmsp_t *memory_space_at(size_t address);
 //void mspace_display(vmsp_t *mspace);
 
 /* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
+#define PAGE_ORDERS 11  /* Buddy blocks from 1 page (order 0) to 4 Mb (order 10) */
+#define HUGE_PAGE_PAGES (1 << (PAGE_ORDERS - 1))
+#define HUGE_PAGE_SIZE (HUGE_PAGE_PAGES * PAGE_SIZE)
+
+#define PGZ_ANY 0
+#define PGZ_DMA 1  /* Pages bellow 16 Mb, reachable by ISA DMA */
+#define PGZ_DMA_LIMIT 0x1000000
+
 /* - */
 void page_range(long long base, long long length);
-/* Allocate a single page for the system and return it's physical address */
+/* Allocate a single page for the system and return it's physical address,
+   or zero with `ENOMEM` once reclaim found nothing */
 size_t page_new();
-/* Look for count pages in continuous memory */
+/* Allocate a page for the MMU tables, which never returns zero */
+size_t page_new_table();
+/* Look for count pages in continuous memory, each page must be released
+   individually using `page_release` */
 size_t page_get(int zone, int count);
 /* Mark a physique page, returned by `mmu_new_page`, as available again */
 void page_release(size_t paddress);
+/* Set the low and high watermarks of the per-CPU page caches */
+int page_cache_tune(int low, int high);
+/* Print usage statistics of the per-CPU page caches */
+void page_cache_info();
+
+#define PGR_ATOMIC  1  /* The shrinker is called from a context that can't sleep */
+#define PGR_USPACE  2  /* The caller owns the current user space, its pages can be evicted */
+typedef int (*page_shrink_t)(int count, int flags);
+/* Register a callback used to release pages under memory pressure */
+void page_shrinker(page_shrink_t shrink);
+/* Check if free pages are under the low watermark or an allocation failed */
+bool page_reclaim_needed();
+/* Ask shrinkers to release `count` objects, or up to the high watermark */
+int page_reclaim(int count, int flags);
+/* Change the watermarks of the reclaim task, zero restore the defaults */
+int page_reclaim_tune(long low, long high);
+/* Block the reclaim task until an allocation needs pages */
+void page_reclaim_wait(long timeout);
+/* Take a page already filled with zeros, return 0 if none is ready */
+size_t page_zero_take();
+/* Clear pages ahead of time to refill the pool of zeroed pages */
+int page_zero_fill(int count);
 /* Free all used pages into a range of virtual addresses */
 void page_sweep(vmsp_t *mspace, size_t address, size_t length, bool clean);
 /* Resolve a page fault */
@@ -143,8 +214,22 @@ int mmu_read_flags(size_t vaddr);
 size_t mmu_drop(size_t vaddr);
 /* - */
 bool mmu_dirty(size_t vaddr);
+/* Tell if the page has been accessed since the last call, and clear the bit */
+bool mmu_young(size_t vaddr);
 /* - */
 size_t mmu_protect(size_t vaddr, int falgs);
+/* Change the rights of all the mapped pages of a range, the TLB is flushed once */
+size_t mmu_protect_range(size_t vaddr, size_t length, int flags);
+/* Clear all the entries of a range and store the dropped pages, tables left empty
+ * are released and the TLB is flushed once. Returns the count of released tables */
+size_t mmu_drop_range(size_t vaddr, size_t length, size_t *pages);
+/* Check if a huge page can be mapped at this address */
+bool mmu_huge_usable(size_t vaddr);
+/* Map a huge page, page-level operations will split it into regular pages */
+void mmu_resolve_huge(size_t vaddr, size_t phys, int flags);
+/* Clear the huge page mapped at an aligned address and flush its TLB entry.
+ * Returns its first page, flagged MMU_DIRTY if written, or 0 if none is mapped */
+size_t mmu_drop_huge(size_t vaddr);
 /* - */
 void mmu_create_uspace(vmsp_t *mspace);
 /* - */
@@ -155,8 +240,65 @@ void mmu_destroy_uspace(vmsp_t *mspace);
 void memory_initialize();
 void memory_sweep();
 void memory_info();
-
-bool page_shared(page_sharing_t *share, size_t page, int count);
+/* Map a single page on a per-CPU slot, interrupts stay disabled until released */
+void *kmap_atomic(size_t page, int flags);
+/* Release the last slot taken by the current CPU */
+void kunmap_atomic(void *ptr);
+
+/* Use an inode as backing store for anonymous pages */
+int swap_activate(inode_t *ino);
+/* Stop using the swap area, pages still swapped out must be freed first */
+int swap_deactivate();
+/* Take a free slot for the page and keep it in cache until written */
+long swap_out(size_t page);
+/* Get back the content of a slot into a new page */
+size_t swap_in(long slot, bool blocking);
+/* Add a user to a slot */
+void swap_dup(long slot);
+/* Remove a user of a slot, the last one release the slot */
+void swap_free(long slot);
+/* Shrinker of anonymous memory */
+int swap_shrink(int count, int flags);
+void swap_info();
+/* Swap entries of an address space */
+long swap_lookup(vmsp_t *vmsp, size_t vaddr);
+void swap_attach(vmsp_t *vmsp, size_t vaddr, long slot);
+long swap_detach(vmsp_t *vmsp, size_t vaddr);
+
+/* Compressed store of swapped out pages, in front of the swap device */
+#define ZSWAP_MAX_SIZE  2016  /* Larger pages don't fit two on a slab */
+void zswap_init();
+/* Change the size of the pool, return the previous one */
+size_t zswap_setup(size_t limit);
+bool zswap_store(long slot, size_t page);
+size_t zswap_load(long slot);
+bool zswap_lookup(long slot);
+void zswap_drop(long slot);
+void zswap_info();
+/* Compress a page, return the size of the data or zero if over `max'. The
+ * hash table is shared, callers are serialized by the swap I/O mutex */
+int zswap_compress(const uint8_t *src, uint8_t *dst, int max);
+/* Restore a page, return zero or -1 if the data doesn't make a whole page */
+int zswap_decompress(const uint8_t *src, int length, uint8_t *dst);
+
+/* Merge identical pages of the mergeable areas of the current user space */
+int merge_scan();
+/* Share the page at this address with an identical one, the space is held
+ * for reading */
+int merge_page(vmsp_t *vmsp, vma_t *vma, size_t vaddr);
+/* Give back private copies of the merged pages of an area */
+void merge_undo(vmsp_t *vmsp, vma_t *vma);
+/* Count a merged page copied back on write */
+void merge_broken(size_t page);
+void merge_init();
+void merge_sweep();
+void merge_info();
+
+/* Return the descriptor of a physical page, NULL if not handled by us */
+page_frame_t *page_frame(size_t paddress);
+/* Update the sharing counter of a page, and return true if the page is
+   private (count == 0) or if this was the last reference (count < 0) */
+bool page_shared(size_t page, int count);
 
 #define PF_ERR "\033[91mSIGSEGV\033[0m "
 #define KB  (PAGE_SIZE / 1024)
@@ -171,7 +313,7 @@ bool page_shared(page_sharing_t *share, size_t page, int count);
 struct kMmu {
     size_t upper_physical_page;  /* Maximum amount of memory */
     size_t pages_amount;  /* Maximum pages amount */
-    atomic_int free_pages;  /* Number of unused free pages */
+    atomic_int free_pages;  /* Number of unused free pages (not counting per-CPU caches) */
     size_t page_size;  /* Page size */
     // size_t uspace_lower_bound;  /* Userspace lower bound */
     // size_t uspace_upper_bound;  /* Userspace upper bound */
@@ -180,6 +322,9 @@ struct kMmu {
     size_t max_vma_size;  /* Maximum size of a VMA */
 
     long soft_page_fault;
+    long page_faults;  /* Faults resolved on an address space */
+    long fault_around;  /* Pages mapped ahead of a read fault */
+    size_t zero_page;  /* Read-only page mapped on read faults of untouched blank pages */
 
     vmsp_t *kspace;  /* Kernel address space */
     vmsp_t *uspace;
@@ -200,6 +345,18 @@ extern struct kMmu __mmu;
 #define VMS_NAME(m) ((m) == __mmu.kspace ? "Krn" : "Usr")
 
 #define VMSP_MAX_SIZE 0x08000000 // 128Mb
+/* Window of cached pages mapped on a read fault of backed areas */
+#define VMA_AROUND_PAGES 16
+/* Pages read ahead of a fault on areas accessed sequentially */
+#define VMA_AHEAD_PAGES 64
+/* Pages mapped at once when an area is populated */
+#define VMA_POPULATE_BATCH 16
+/* Pages dropped from the page tables at once when an area is unmapped */
+#define VMA_UNMAP_BATCH 64
+/* Pages of a clone mapped at once, on the first fault of their range */
+#define VMSP_DEFERRED_PAGES 256
+/* Pages reclaimed by a faulting task while memory is under pressure */
+#define VMSP_RECLAIM_PAGES 32
 
 struct vmsp
 {
@@ -213,10 +370,20 @@ struct vmsp
     size_t p_size;  /* Private allocated page counter */
     size_t s_size;  /* Shared allocated page counter */
     size_t t_size;  /* Table allocated page counter */
-    splock_t lock;  /* Memory space protection lock */
+    size_t h_size;  /* Huge pages counter */
+    size_t w_size;  /* Swapped out page counter */
+    size_t areas;  /* Live VMAs counter */
+    bbtree_t swaps;  /* Slots of the swapped out pages, by address */
+    bbtree_t deferred;  /* Ranges of pages copied by a clone, not yet mapped */
+    size_t d_size;  /* Pages on deferred ranges */
+    rwsem_t lock;  /* Shared by page faults, exclusive for layout changes */
+    rwlock_t klock;  /* Lock of the kernel space, changed by kmap in atomic contexts */
+    splock_t plock;  /* Page tables, counters and swap slots lock of faults */
+    size_t seq;  /* Counter of exclusive sections, to revalidate faults */
+    size_t evict_hand;  /* Address where the last eviction pass stopped */
+    llnode_t node;  /* Linkage on the list of user spaces */
     dlproc_t *proc;
     size_t max_size;
-    page_sharing_t *share;
 };
 
 struct vma
@@ -225,6 +392,9 @@ struct vma
     bbnode_t node;  /* Binary tree node of VMAs contains the base address */
     vmsp_t *space;
     size_t length;  /* The length of this VMA */
+    size_t lower;  /* Lowest address of the subtree of VMAs */
+    size_t upper;  /* Highest address of the subtree of VMAs */
+    size_t max_gap;  /* Largest free gap inside the subtree of VMAs */
     union
     {
         inode_t *ino; // File or pipe
@@ -239,24 +409,31 @@ struct vma
 struct vma_ops 
 {
     size_t(*fetch)(vmsp_t *vmsp, vma_t *vma, xoff_t offset, bool blocking);
+    size_t(*fetch_run)(vmsp_t *vmsp, vma_t *vma, int count);
     void (*release)(vmsp_t *vmsp, vma_t *vma, xoff_t offset, size_t page);
     void (*resolve)(vmsp_t *vmsp, vma_t *vma, size_t vaddr, size_t page);
     int (*shared)(vmsp_t *vmsp, vma_t *vma, size_t address, size_t page);
-    void (*unmap)(vmsp_t *vmsp, vma_t *vma, size_t address);
+    void (*unmap)(vmsp_t *vmsp, vma_t *vma, size_t address, size_t page);
     int (*protect)(vmsp_t *vmsp, vma_t *vma, int flags);
     void (*split)(vma_t *va1, vma_t *va2);
     void (*clone)(vmsp_t *vmsp1, vmsp_t *vmsp2, vma_t *va1, vma_t *va2);
     char *(*print)(vma_t *vma, char *buf, size_t len);
     void (*close)(vma_t *vma);
+    int (*huge)(vmsp_t *vmsp, vma_t *vma, size_t vaddr);
+    int (*evict)(vmsp_t *vmsp, vma_t *vma, size_t vaddr);
 
 };
 
 
-struct page_sharing
+#define PGF_MERGED  1  /* The frame is kept by the page merger */
+
+struct page_frame
 {
-    splock_t lock;
-    hmap_t map;
-    atomic_int usage;
+    llnode_t node;  /* Free list linkage */
+    atomic_int usage;  /* Address spaces sharing the page, zero if private */
+    uint16_t index;  /* Index of the page inside its zone */
+    uint8_t state;  /* Allocator state */
+    uint8_t flags;  /* PGF_* */
 };
 
 
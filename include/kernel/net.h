@@ -257,6 +257,10 @@ int net_destroy_stack(netstack_t *stack);
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 // Socket kernel buffer
 
+/* Allocate a packet able to hold `len' bytes */
+skb_t *net_skb_alloc(ifnet_t *net, unsigned len);
+/* Release a packet */
+void net_skb_free(skb_t *skb);
 /* Create a new tx packet */
 skb_t *net_packet(ifnet_t *net);
 /* Create a new rx packet and push it into received queue */
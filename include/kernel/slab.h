@@ -0,0 +1,78 @@
+/*
+ *      This file is part of the KoraOS project.
+ *  Copyright (C) 2015-2021  <Fabien Bavent>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   - - - - - - - - - - - - - - -
+ */
+#ifndef _KERNEL_SLAB_H
+#define _KERNEL_SLAB_H 1
+
+#include <kernel/stdc.h>
+#include <kora/llist.h>
+#include <kora/splock.h>
+
+#define KMEM_CPUS  16
+#define KMEM_MAGAZINE  16
+
+/* Objects aren't cleared on allocation */
+#define KMEM_NOZERO  1
+
+typedef struct kmem_cache kmem_cache_t;
+typedef struct kmem_magazine kmem_magazine_t;
+typedef void (*kmem_ctor_t)(void *);
+
+/* Per-CPU stack of free objects, refilled and drained by batches */
+struct kmem_magazine {
+    splock_t lock;
+    int count;
+    void *objs[KMEM_MAGAZINE];
+};
+
+/* Cache of fixed-size objects carved into page sized slabs */
+struct kmem_cache {
+    const char *name;
+    size_t size;
+    kmem_ctor_t ctor;
+    int flags;
+    bool ready;
+    bool dynamic;
+    splock_t lock;
+    size_t stride;
+    size_t link;
+    int per_slab;
+    int slabs;
+    int empties;
+    int inuse;
+    long allocs;
+    long frees;
+    llhead_t partial;
+    llnode_t node;
+    kmem_magazine_t mags[KMEM_CPUS];
+};
+
+/* Static initializer of a cache of objects of type `t' */
+#define INIT_KMEM_CACHE(n,t,c)  { .name = (n), .size = sizeof(t), .ctor = (c) }
+
+kmem_cache_t *kmem_cache_create(const char *name, size_t size, kmem_ctor_t ctor);
+void kmem_cache_destroy(kmem_cache_t *cache);
+void *kmem_cache_alloc(kmem_cache_t *cache);
+void kmem_cache_free(kmem_cache_t *cache, void *ptr);
+int kmem_cache_shrink(kmem_cache_t *cache);
+
+int kmem_sweep();
+void kmem_info();
+
+#endif /* _KERNEL_SLAB_H */
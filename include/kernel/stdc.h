@@ -67,12 +67,18 @@ enum klog {
 
 
 /* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
-/* Memory allocation */
+/* Memory allocation, kalloc doesn't clear the block unlike kzalloc */
 void *kalloc(size_t len);
+void *kzalloc(size_t len);
 void kfree(void *ptr);
-#ifndef KORA_KRN
+#if !defined(KORA_KRN) || defined(KALLOC_PROFILE)
+/* Callsites are given to the heap profiler */
 # define kalloc(n) kalloc_(n,#n " at " __AT__)
+# define kzalloc(n) kzalloc_(n,#n " at " __AT__)
 void *kalloc_(size_t len, const char *);
+void *kzalloc_(size_t len, const char *);
+#endif
+#ifndef KORA_KRN
 char *kstrdup(const char *str);
 char *kstrndup(const char *str, size_t max);
 #else
@@ -126,6 +132,7 @@ void *memcpy32(void *dest, void *src, size_t lg);
 void *memset32(void *dest, uint32_t val, size_t lg);
 
 void stackdump(size_t frame);
+bool can_sleep(void);
 void might_sleep(void);
 
 #endif /* _KERNEL_STDC_H */
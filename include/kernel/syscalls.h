@@ -103,6 +103,8 @@ enum syscall_no {
 
     SYS_MKFS,
     SYS_MOUNT,
+
+    SYS_MADVISE,
 };
 
 // #define SPW_SHUTDOWN 0xcafe
@@ -130,6 +132,7 @@ long sys_thread(const char *name, void *entry, void *params, size_t len, int fla
 void *sys_mmap(void *addr, size_t length, unsigned flags, int fd, size_t off);
 long sys_munmap(void *addr, size_t length);
 long sys_mprotect(void *addr, size_t length, unsigned flags);
+long sys_madvise(void *addr, size_t length, int advice);
 /* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
 
 long sys_ginfo(unsigned info, char *buf, size_t len);
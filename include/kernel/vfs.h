@@ -345,7 +345,8 @@ inode_t *vfs_inodeof(fnode_t *node);
 fnode_t *vfs_search(fs_anchor_t *fsanchor, const char *pathname, user_t *user, bool resolve, bool follow);
 inode_t *vfs_search_ino(fs_anchor_t *fsanchor, const char *pathname, user_t *user, bool follow);
 
-void vfs_scavenge(int max);
+int vfs_scavenge(int max);
+int vfs_reclaim(int count, int flags);
 
 
 // Generic
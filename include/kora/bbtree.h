@@ -25,6 +25,7 @@
 typedef struct bbtree bbtree_t;
 typedef struct bbnode bbnode_t;
 typedef struct bbslot bbslot_t;
+typedef void (*bbaugment_t)(bbnode_t *node, bbnode_t *left, bbnode_t *right);
 
 #ifndef itemof
 #  undef offsetof
@@ -42,6 +43,7 @@ struct bbtree
 {
     bbnode_t *root_;
     int count_;
+    bbaugment_t augment_;
 };
 
 /* BBTree (self-balancing binary tree) node */
@@ -61,9 +63,11 @@ struct bbslot
 };
 
 void bbtree_init(bbtree_t *tree);
+void bbtree_init_augmented(bbtree_t *tree, bbaugment_t augment);
 int bbtree_check(bbnode_t *node);
 int bbtree_insert(bbtree_t *tree, bbnode_t *node);
 int bbtree_remove(bbtree_t *tree, size_t value);
+void bbtree_update(bbtree_t *tree, bbnode_t *node);
 
 bbnode_t *bbtree_left_(bbnode_t *node);
 bbnode_t *bbtree_right_(bbnode_t *node);
@@ -71,6 +75,7 @@ bbnode_t *bbtree_next_(bbnode_t *node);
 bbnode_t *bbtree_previous_(bbnode_t *node);
 
 bbnode_t *bbtree_search_(bbnode_t *node, size_t value, int accept);
+bbnode_t *bbtree_child_(bbnode_t *node, int side);
 
 #define bbtree_first(t,s,m) (s*)itemof(bbtree_left_((t)->root_),s,m)
 #define bbtree_last(t,s,m) (s*)itemof(bbtree_right_((t)->root_),s,m)
@@ -80,6 +85,10 @@ bbnode_t *bbtree_search_(bbnode_t *node, size_t value, int accept);
 #define bbtree_left(n,s,m) (s*)itemof(bbtree_left_(n),s,m)
 #define bbtree_right(n,s,m) (s*)itemof(bbtree_right_(n),s,m)
 
+#define bbtree_root(t,s,m) (s*)itemof(bbtree_child_((t)->root_,0),s,m)
+#define bbtree_left_child(n,s,m) (s*)itemof(bbtree_child_(n,-1),s,m)
+#define bbtree_right_child(n,s,m) (s*)itemof(bbtree_child_(n,1),s,m)
+
 #define bbtree_each(t,n,s,m)  ((n)=bbtree_first(t,s,m);(n);(n)=bbtree_next(&(n)->m,s,m))
 
 #define bbtree_search_eq(t,v,s,m) (s*)itemof(bbtree_search_((t)->root_,v,0),s,m)
@@ -51,12 +51,14 @@ struct rwlock {
 static inline void rwlock_init(rwlock_t *lock)
 {
     splock_init(&lock->lock);
-    atomic_init(&lock->readers, 0);
+    atomic_store(&lock->readers, 0);
 }
 
-/* Block until the lock allow reading */
+/* Block until the lock allow reading, interrupts are disabled like for
+ * spin-locks, so a writer never waits on a preempted reader */
 static inline void rwlock_rdlock(rwlock_t *lock)
 {
+    irq_disable();
     for (;;) {
         atomic_inc(&lock->readers);
         if (!splock_locked(&lock->lock))
@@ -64,7 +66,7 @@ static inline void rwlock_rdlock(rwlock_t *lock)
 
         atomic_dec(&lock->readers);
         while (splock_locked(&lock->lock))
-            RELAX;
+            __asm_pause_;
     }
 }
 
@@ -73,13 +75,14 @@ static inline void rwlock_wrlock(rwlock_t *lock)
 {
     splock_lock(&lock->lock);
     while (lock->readers)
-        RELAX;
+        __asm_pause_;
 }
 
 /* Release a lock previously taken for reading */
 static inline void rwlock_rdunlock(rwlock_t *lock)
 {
     atomic_dec(&lock->readers);
+    irq_enable();
 }
 
 /* Release a lock previously taken for writing */
@@ -91,11 +94,13 @@ static inline void rwlock_wrunlock(rwlock_t *lock)
 /* Try to grab a lock for reading but without blocking. */
 static inline bool rwlock_rdtrylock(rwlock_t *lock)
 {
+    irq_disable();
     atomic_inc(&lock->readers);
     if (!splock_locked(&lock->lock))
         return true;
 
     atomic_dec(&lock->readers);
+    irq_enable();
     return false;
 }
 
@@ -123,8 +128,9 @@ static inline bool rwlock_upgrade(rwlock_t *lock)
         return false;
 
     atomic_dec(&lock->readers);
+    irq_enable();
     while (lock->readers)
-        RELAX;
+        __asm_pause_;
 
     return true;
 }
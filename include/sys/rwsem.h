@@ -0,0 +1,51 @@
+/*
+ *      This file is part of the KoraOS project.
+ *  Copyright (C) 2015-2021  <Fabien Bavent>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   - - - - - - - - - - - - - - -
+ */
+#ifndef SYS_RWSEM_H
+#define SYS_RWSEM_H 1
+
+#include <bits/cdefs.h>
+#include <threads.h>
+#include <stdbool.h>
+
+typedef struct rwsem rwsem_t;
+
+/* Read/write lock on which waiters sleep, writers have precedence over
+ * incoming readers */
+struct rwsem {
+    mtx_t mtx;
+    cnd_t cv;
+    int readers;
+    int writers;  /* Writers waiting or holding the lock */
+    bool locked;  /* Held for writing */
+};
+
+__STDC_GUARD
+
+int rwsem_init(rwsem_t *sem);
+void rwsem_destroy(rwsem_t *sem);
+void rwsem_rdlock(rwsem_t *sem);
+void rwsem_rdunlock(rwsem_t *sem);
+void rwsem_wrlock(rwsem_t *sem);
+void rwsem_wrunlock(rwsem_t *sem);
+bool rwsem_wrlocked(rwsem_t *sem);
+
+__STDC_END
+
+#endif /* SYS_RWSEM_H */
@@ -20,6 +20,7 @@
 #include <kernel/stdc.h>
 #include <kernel/memory.h>
 #include <kernel/tasks.h>
+#include <kernel/kprof.h>
 
 /* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
 
@@ -72,28 +73,45 @@ EXPORT_SYMBOL(kunmap, 0);
 void *malloc(size_t size);
 void free(void *ptr);
 
-void *kalloc_(size_t size, const char *expr)
-{
-    return kalloc(size);
-}
+#undef kalloc
+#undef kzalloc
 
+/* Blocks over the arena chunk limit are mapped by the heap on their own */
 void *kalloc(size_t size)
 {
-    if (size > PAGE_SIZE) {
-        kprintf(-1, "Page is size %x\n", size);
-        stackdump(12);
-    }
-    assert(size <= PAGE_SIZE);
     void *ptr = malloc(size);
+    assert(ptr != NULL);
+    return ptr;
+}
+
+void *kzalloc(size_t size)
+{
+    void *ptr = kalloc(size);
     memset(ptr, 0, size);
     return ptr;
 }
 
+void *kalloc_(size_t size, const char *expr)
+{
+    void *ptr = kalloc(size);
+    kprof_alloc(ptr, size, expr);
+    return ptr;
+}
+
+void *kzalloc_(size_t size, const char *expr)
+{
+    void *ptr = kzalloc(size);
+    kprof_alloc(ptr, size, expr);
+    return ptr;
+}
+
 void kfree(void *ptr)
 {
     assert(ptr != NULL);
-    size_t size = 8; // TODO szofalloc(ptr);
-    memset(ptr, 0, size);
+    kprof_free(ptr);
+#ifndef NDEBUG
+    memset(ptr, 0, sizeof(void *) * 2);
+#endif
     free(ptr);
 }
 
@@ -117,7 +135,9 @@ char *kstrndup(const char *str, size_t len)
 }
 
 EXPORT_SYMBOL(kalloc_, 0);
+EXPORT_SYMBOL(kzalloc_, 0);
 EXPORT_SYMBOL(kalloc, 0);
+EXPORT_SYMBOL(kzalloc, 0);
 EXPORT_SYMBOL(kfree, 0);
 EXPORT_SYMBOL(kstrdup, 0);
 
@@ -72,10 +72,15 @@ void irq_disable()
 }
 
 
-void might_sleep(void)
+bool can_sleep(void)
 {
     cpu_info_t * pc = kcpu();
-    if (pc != NULL && sysinfo.is_ready && pc->irq_semaphore == 0)
+    return pc != NULL && sysinfo.is_ready && pc->irq_semaphore == 0;
+}
+
+void might_sleep(void)
+{
+    if (can_sleep())
         return;
     assert("won't sleep");
 }
@@ -108,7 +113,7 @@ void irq_register(int no, irq_handler_t func, void *data)
     if (no < 0 || no >= IRQ_COUNT)
         return;
     kprintf(KL_IRQ, "Register IRQ%d <%08x(%08x)>\n", no, func, data);
-    irq_record_t *record = (irq_record_t *)kalloc(sizeof(irq_record_t));
+    irq_record_t *record = (irq_record_t *)kzalloc(sizeof(irq_record_t));
     record->func = func;
     record->data = data;
     splock_lock(&irqv[no].lock);
@@ -30,6 +30,9 @@ void module_init();
 void cpu_setup(sys_info_t *);
 void arch_init();
 _Noreturn void kloader();
+_Noreturn void kzeroing();
+_Noreturn void kreclaim();
+_Noreturn void kmerging();
 
 sys_info_t sysinfo;
 #ifndef _VTAG_
@@ -56,6 +59,9 @@ void kstart()
     arch_init();
 
     task_start("kloader", kloader, NULL);
+    task_start("kzeroing", kzeroing, NULL);
+    task_start("kreclaim", kreclaim, NULL);
+    task_start("kmerging", kmerging, NULL);
 
     sysinfo.is_ready = 1;
     irq_zero();
@@ -75,6 +81,35 @@ void kready()
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 
+/* Fill the pool of zeroed pages, but only while no other task is ready */
+_Noreturn void kzeroing()
+{
+    for (;;) {
+        if (__scheduler.sch_queue.count_ != 0 || page_zero_fill(1) == 0)
+            sleep_timer(MSEC_TO_USEC(50));
+    }
+}
+
+/* Release cached pages once free memory fall under the low watermark, or
+ * as soon as an allocation asks for it */
+_Noreturn void kreclaim()
+{
+    for (;;) {
+        page_reclaim_wait(MSEC_TO_USEC(20));
+        if (page_reclaim_needed())
+            page_reclaim(0, 0);
+    }
+}
+
+/* Look for identical pages on the areas marked as mergeable, at slow pace */
+_Noreturn void kmerging()
+{
+    for (;;) {
+        merge_scan();
+        sleep_timer(MSEC_TO_USEC(500));
+    }
+}
+
 static int kloader_open_module(const char *name, inode_t *ino)
 {
     dlproc_t *proc = __mmu.kspace->proc;
@@ -126,8 +161,8 @@ static int kloader_open_module(const char *name, inode_t *ino)
 
 _Noreturn void kloader()
 {
-    char *buffer = kalloc(256);
-    char *name = kalloc(256);
+    char *buffer = kzalloc(256);
+    char *name = kzalloc(256);
 
     // First task is incomplete!
     __current->fsa = __vfs_share->fsanchor;
@@ -51,7 +51,8 @@ void *sys_mmap(void *addr, size_t length, unsigned flags, int fd, size_t off)
         vma |= VMA_STACK;
     else
         vma |= VMA_ANON;
-    if (flags & MAP_POPULATE && !(flags & MAP_SHARED))
+    // Pages are brought by batches once the area is mapped
+    if (flags & MAP_POPULATE)
         vma |= VM_RESOLVE;
 
     // TODO - Transform flags !
@@ -74,3 +75,9 @@ long sys_mprotect(void *addr, size_t length, unsigned flags)
     // TODO - Transform flags !
     return vmsp_protect(__current->vmsp, (size_t)addr, length, vma);
 }
+
+long sys_madvise(void *addr, size_t length, int advice)
+{
+    // Hints use the same values as MADV_*
+    return vmsp_advise(__current->vmsp, (size_t)addr, length, advice);
+}
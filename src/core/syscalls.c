@@ -42,6 +42,7 @@ syscall_info_t __syscalls_info[] = {
     [SYS_MMAP] = SCALL_ENTRY(mmap, ARG_PTR, ARG_LEN, ARG_FLG, ARG_FD, ARG_LEN, ARG_PTR, 5),
     [SYS_MUNMAP] = SCALL_ENTRY(munmap, ARG_PTR, ARG_LEN, 0, 0, 0, ARG_INT, 2),
     // [SYS_MPROTECT] = SCALL_ENTRY(mprotect, ),
+    [SYS_MADVISE] = SCALL_ENTRY(madvise, ARG_PTR, ARG_LEN, ARG_INT, 0, 0, ARG_INT, 3),
 
     [SYS_GINFO] = SCALL_ENTRY(ginfo, ARG_INT, ARG_PTR, ARG_LEN, 0, 0, ARG_INT, 1),
     [SYS_SINFO] = SCALL_ENTRY(sinfo, ARG_INT, ARG_PTR, ARG_LEN, 0, 0, ARG_INT, 1),
@@ -12,7 +12,7 @@ static inode_t *dlib_lookfor_at(fs_anchor_t *fsanchor, user_t *user, const char
 {
     char *rl;
     char *path = kstrdup(xpath);
-    char *buf = kalloc(4096);
+    char *buf = kzalloc(4096);
 
     for (char *dir = strtok_r(path, ":;", &rl); dir; dir = strtok_r(NULL, ":;", &rl)) {
         snprintf(buf, 4096, "%s/%s", dir, name);
@@ -123,7 +123,7 @@ int dlib_open(vmsp_t *vmsp, fs_anchor_t *fsanchor, user_t *user, const char *nam
 
 dlproc_t *dlib_proc()
 {
-    dlproc_t *proc = kalloc(sizeof(dlproc_t));
+    dlproc_t *proc = kzalloc(sizeof(dlproc_t));
     hmp_init(&proc->libs_map, 8);
     hmp_init(&proc->symbols_map, 8);
     splock_init(&proc->lock);
@@ -150,7 +150,7 @@ int dlib_destroy(dlproc_t *proc)
 dlib_t *dlib_create(const char *name, inode_t *ino)
 {
     might_sleep();
-    dlib_t *lib = kalloc(sizeof(dlib_t));
+    dlib_t *lib = kzalloc(sizeof(dlib_t));
     mtx_init(&lib->mtx, mtx_plain);
     lib->name = kstrdup(name);
     if (ino != NULL)
@@ -158,8 +158,6 @@ dlib_t *dlib_create(const char *name, inode_t *ino)
     return lib;
 }
 
-extern void page_release_kmap_stub(page_t page);
-
 void dlib_clean(dlproc_t *proc, dlib_t *lib)
 {
     might_sleep();
@@ -205,11 +203,7 @@ void dlib_clean(dlproc_t *proc, dlib_t *lib)
         int size = ALIGN_UP(lib->length, PAGE_SIZE) / PAGE_SIZE;
         for (int i = 0; i < size; ++i) {
             if (lib->pages[i] != 0)
-#ifdef KORA_KRN
                 page_release(lib->pages[i]);
-#else
-                page_release_kmap_stub(lib->pages[i]);
-#endif
         }
         kfree(lib->pages);
     }
@@ -382,7 +376,7 @@ static int dlib_relloc_page(dlib_t *lib, char *ptr, xoff_t off)
 
 void dlib_add_symbol(dlproc_t *proc, dlib_t *lib, const char *name, size_t value)
 {
-    dlsym_t *symbol = kalloc(sizeof(dlsym_t));
+    dlsym_t *symbol = kzalloc(sizeof(dlsym_t));
     symbol->name = kstrdup(name);
     symbol->address = value;
     splock_lock(&proc->lock);
@@ -458,16 +452,26 @@ size_t dlib_fetch_page(dlib_t *lib, size_t off, bool blocking)
             return 0;
         }
         int size = ALIGN_UP(lib->length, PAGE_SIZE) / PAGE_SIZE;
-        lib->pages = kalloc(size * sizeof(size_t));
+        lib->pages = kzalloc(size * sizeof(size_t));
     }
     size_t pg = lib->pages[idx];
     if (pg == 0 && blocking) {
         dlsection_t *sec = dlib_section_at(lib, off);
         assert(sec != NULL);
         size_t foff = off + (sec->foff & ~(PAGE_SIZE-1)) - sec->offset;
-        void *ptr = kmap(PAGE_SIZE, NULL, 0, VM_RW | VMA_PHYS);
-        pg = mmu_read((size_t)ptr);
-        memset(ptr, 0, PAGE_SIZE);
+        pg = page_zero_take();
+        bool blank = pg != 0;
+        if (!blank)
+            pg = page_new();
+        if (pg == 0) {
+            mtx_unlock(&lib->mtx);
+            return 0;
+        }
+        void *ptr = kmap(PAGE_SIZE, NULL, pg, VM_RW | VMA_PHYS);
+#ifdef KORA_KRN
+        if (!blank)
+            memset(ptr, 0, PAGE_SIZE);
+#endif
 
         long poff = sec->moff - idx * PAGE_SIZE;
         long psiz = (sec->moff + sec->fsize) - idx * PAGE_SIZE;
@@ -501,11 +505,7 @@ void dlib_release_page(dlib_t *lib, size_t off, size_t pg)
         for (int i = 0; i < size; ++i) {
             size_t page = lib->pages[i];
             if (page != 0)
-#ifdef KORA_KRN
                 page_release(page);
-#else
-                page_release_kmap_stub(page);
-#endif
         }
         kfree(lib->pages);
         lib->pages = NULL;
@@ -127,7 +127,7 @@ void elf_requires(dlib_t *lib, elf_phead_t *ph, blkmap_t *bkm, elf_string_helper
         off += 4;
         dyen = ADDR_OFF(blk_map(bkm, off / PAGE_SIZE, VM_RD), off % PAGE_SIZE);
         int idx = *dyen;
-        dlname_t *dep = kalloc(sizeof(dlname_t));
+        dlname_t *dep = kzalloc(sizeof(dlname_t));
         dep->name = elf_string(string_table, idx);
         // kprintf(-1, "Rq:  %s \n", dep->name);
         ll_append(&lib->depends, &dep->node);
@@ -232,7 +232,7 @@ int elf_parse(dlib_t *lib, blkmap_t *bkm)
         const char *sname = "   ....";
         if (ph_tbl[i].type == ELF_PH_LOAD) {
             sname = "   LOAD";
-            dlsection_t *section = kalloc(sizeof(dlsection_t));
+            dlsection_t *section = kzalloc(sizeof(dlsection_t));
             ll_append(&lib->sections, &section->node);
             elf_section(&ph_tbl[i], section);
             if (lib->base > section->offset)
@@ -380,7 +380,7 @@ int elf_parse(dlib_t *lib, blkmap_t *bkm)
         size_t off = dynamic.sym_tab + i * dynamic.sym_ent;
         elf_read_cross_page(bkm_sym, (char *)&sym_tbl, sizeof(elf_sym32_t), off, VM_RD);
 
-        dlsym_t *sym = kalloc(sizeof(dlsym_t));
+        dlsym_t *sym = kzalloc(sizeof(dlsym_t));
         ll_append(&symbols, &sym->node);
         elf_symbol(sym, &sym_tbl, lib, &dynamic, &str_strings);
 #ifdef WIN32
@@ -406,7 +406,7 @@ int elf_parse(dlib_t *lib, blkmap_t *bkm)
             if (reloc.type == 0)
                 continue;
 
-            dlreloc_t *rel = kalloc(sizeof(dlreloc_t));
+            dlreloc_t *rel = kzalloc(sizeof(dlreloc_t));
             elf_relocation(rel, &reloc, &symbols);
             if (rel->offset == 0) {
                 kfree(rel);
@@ -23,44 +23,44 @@
 /* - */
 int vmsp_check(vmsp_t *vmsp, const void *ptr, size_t len, int flags)
 {
-    splock_lock(&vmsp->lock);
+    vmsp_rdlock(vmsp);
     vma_t *vma = vmsp_find_area(vmsp, (size_t)ptr);
     if (vma == NULL) {
-        splock_unlock(&vmsp->lock);
+        vmsp_rdunlock(vmsp);
         errno = EINVAL;
         return -1;
     }
 
     size_t max = vma->node.value_ + vma->length - (size_t)ptr;
     if (max < len) {
-        splock_unlock(&vmsp->lock);
+        vmsp_rdunlock(vmsp);
         errno = EINVAL;
         return -1;
     }
 
     if ((flags & VM_WR) && !(vma->flags & VM_WR)) {
-        splock_unlock(&vmsp->lock);
+        vmsp_rdunlock(vmsp);
         errno = EPERM;
         return -1;
     }
 
-    splock_unlock(&vmsp->lock);
+    vmsp_rdunlock(vmsp);
     return 0;
 }
 
 /* - */
 int vmsp_check_str(vmsp_t *vmsp, const char *str, size_t max)
 {
-    splock_lock(&vmsp->lock);
+    vmsp_rdlock(vmsp);
     vma_t *vma = vmsp_find_area(vmsp, (size_t)str);
     if (vma == NULL) {
-        splock_unlock(&vmsp->lock);
+        vmsp_rdunlock(vmsp);
         errno = EINVAL;
         return -1;
     }
 
     max = MIN(max, vma->node.value_ + vma->length - (size_t)str);
-    splock_unlock(&vmsp->lock);
+    vmsp_rdunlock(vmsp);
 
     if (strnlen(str, max) >= max) {
         errno = EINVAL;
@@ -73,16 +73,16 @@ int vmsp_check_str(vmsp_t *vmsp, const char *str, size_t max)
 /* - */
 int vmsp_check_strarray(vmsp_t *vmsp, const char **str)
 {
-    splock_lock(&vmsp->lock);
+    vmsp_rdlock(vmsp);
     vma_t *vma = vmsp_find_area(vmsp, (size_t)str);
     if (vma == NULL) {
-        splock_unlock(&vmsp->lock);
+        vmsp_rdunlock(vmsp);
         errno = EINVAL;
         return -1;
     }
 
     size_t max = vma->node.value_ + vma->length - (size_t)str;
-    splock_unlock(&vmsp->lock);
+    vmsp_rdunlock(vmsp);
 
     size_t len = sizeof(char *);
     for (int i = 0; len < max; ++i, len += sizeof(char*)) {
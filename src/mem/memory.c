@@ -20,16 +20,60 @@
 #include <kernel/memory.h>
 // #include <kernel/cpu.h>
 // #include <kernel/vfs.h>
+#include <kernel/tasks.h>
 #include <kora/mcrs.h>
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
 #include <kernel/dlib.h>
+#include <kernel/slab.h>
 
 
 vmsp_t kernel_space;
 struct kMmu __mmu;
 
+#define KMAP_CPUS  16
+#define KMAP_SLOTS  4  /* Nested temporary mappings per CPU */
+
+static size_t kmap_slots;
+static int kmap_depth[KMAP_CPUS];
+
+/* Reserve the kernel range of the temporary mapping slots */
+static void kmap_atomic_setup()
+{
+    size_t length = KMAP_CPUS * KMAP_SLOTS * PAGE_SIZE;
+    kmap_slots = vmsp_map(__mmu.kspace, 0, length, NULL, 0, VMA_HEAP | VM_RW);
+    assert(kmap_slots != 0);
+    // Build the page tables now, taking a slot must never allocate
+    for (size_t address = kmap_slots; address < kmap_slots + length; address += PAGE_SIZE) {
+        mmu_resolve(address, 0, VM_RW);
+        page_release(mmu_drop(address));
+    }
+}
+
+/* Map a single page on a slot of the current CPU, interrupts are disabled
+ * until the slot is released, so mappings must not sleep */
+void *kmap_atomic(size_t page, int flags)
+{
+    irq_disable();
+    int cpu = cpu_no();
+    assert(cpu < KMAP_CPUS && kmap_depth[cpu] < KMAP_SLOTS);
+    size_t address = kmap_slots + (cpu * KMAP_SLOTS + kmap_depth[cpu]++) * PAGE_SIZE;
+    mmu_resolve(address, page, flags & VM_RW);
+    return (void *)address;
+}
+
+/* Release the last slot taken by the current CPU */
+void kunmap_atomic(void *ptr)
+{
+    int cpu = cpu_no();
+    size_t address = kmap_slots + (cpu * KMAP_SLOTS + --kmap_depth[cpu]) * PAGE_SIZE;
+    assert((size_t)ptr == address);
+    // The slot was only used by this CPU, a local invalidation is enough
+    mmu_drop(address);
+    irq_enable();
+}
+
 void memory_initialize()
 {
     __mmu.max_vma_size = _Gib_;
@@ -40,13 +84,29 @@ void memory_initialize()
 
     /* Init Kernel memory space structure */
     memset(&kernel_space, 0, sizeof(kernel_space));
-    bbtree_init(&kernel_space.tree);
-    splock_init(&kernel_space.lock);
+    bbtree_init_augmented(&kernel_space.tree, vma_augment);
+    bbtree_init(&kernel_space.swaps);
+    bbtree_init(&kernel_space.deferred);
+    rwlock_init(&kernel_space.klock);
+    splock_init(&kernel_space.plock);
     kernel_space.max_size = VMSP_MAX_SIZE;
     __mmu.kspace = &kernel_space;
+    page_shrinker(swap_shrink);
+    merge_init();
 
     /* Enable MMU */
     mmu_enable();
+    kmap_atomic_setup();
+
+    // The zero page is always held by the kernel, unmapping never releases it
+    __mmu.zero_page = page_new();
+    void *ptr = kmap_atomic(__mmu.zero_page, VM_RW);
+#ifdef KORA_KRN
+    memset(ptr, 0, PAGE_SIZE);
+#endif
+    kunmap_atomic(ptr);
+    page_shared(__mmu.zero_page, 1);
+    zswap_init();
 
     char tmp[20];
     kprintf(KL_MSG, "Memory available %s\n", sztoa_r(__mmu.pages_amount * PAGE_SIZE, tmp));
@@ -55,6 +115,10 @@ void memory_initialize()
 void memory_sweep()
 {
     vmsp_sweep(__mmu.kspace);
+    merge_sweep();
+    if (page_shared(__mmu.zero_page, -1))
+        page_release(__mmu.zero_page);
+    __mmu.zero_page = 0;
     mmu_leave();
     page_teardown();
 
@@ -78,6 +142,11 @@ void memory_info()
     kprintf(KL_DBG, "MemAvailable:  %9s (%dK)\n", sztoa(__mmu.pages_amount * PAGE_SIZE), __mmu.pages_amount * 4);
     kprintf(KL_DBG, "MemDetected:   %9s (%dK)\n", sztoa(__mmu.upper_physical_page * PAGE_SIZE), __mmu.upper_physical_page * 4);
     kprintf(KL_DBG, "MemUsed:       %9s (%dK)\n", sztoa((__mmu.pages_amount - __mmu.free_pages) * PAGE_SIZE), (__mmu.pages_amount - __mmu.free_pages) * 4);
+    kprintf(KL_DBG, "PageFaults:    %9ld (%ld around)\n", __mmu.page_faults, __mmu.fault_around);
+    swap_info();
+    merge_info();
+    page_cache_info();
+    kmem_info();
 }
 
 // Buffers:           53664 kB
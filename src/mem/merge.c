@@ -0,0 +1,334 @@
+/*
+ *      This file is part of the KoraOS project.
+ *  Copyright (C) 2015-2021  <Fabien Bavent>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   - - - - - - - - - - - - - - -
+ */
+#include <kernel/stdc.h>
+#include <kernel/memory.h>
+#include <kernel/tasks.h>
+#include <kora/bbtree.h>
+#include <kora/splock.h>
+#include <bits/atomic.h>
+#include <assert.h>
+
+/* Private pages of the areas marked as mergeable are hashed by a scanner.
+ * A page whose checksum didn't change since the previous pass becomes a
+ * stable frame, mapped read-only and shared like a cloned page. The later
+ * pages with the same content are mapped on this frame instead, and a write
+ * copies them back through the copy-on-write path of the fault handler.
+ *
+ * The stable tree keeps a reference on its frames, they are released once
+ * no space maps them anymore. Frames of different content sharing the same
+ * checksum are chained after the one on the tree.
+ *
+ * Every user space is scanned in turn, held open and installed on the MMU
+ * for the pass, under its read lock. A page is made read-only under the
+ * fault lock before its content is checked again, later writes fault and
+ * wait for it.
+ */
+
+typedef struct merge_item merge_item_t;
+typedef struct merge_frame merge_frame_t;
+
+struct merge_item
+{
+    bbnode_t node;  /* Physical address of the page */
+    uint32_t checksum;
+    long pass;
+};
+
+struct merge_frame
+{
+    bbnode_t node;  /* Checksum of the content */
+    size_t page;
+    merge_frame_t *next;  /* Next frame with the same checksum */
+};
+
+struct merge_state
+{
+    bbtree_t items;
+    bbtree_t stable;
+    splock_t lock;
+    long pass;
+    long frames;
+    long merged;
+    atomic_int unmerged;
+};
+
+struct merge_state __merge;
+
+
+static uint32_t merge_checksum(size_t vaddr)
+{
+    uint32_t sum = 2166136261;
+#ifdef KORA_KRN
+    uint32_t *ptr = (uint32_t *)vaddr;
+    for (int i = 0; i < PAGE_SIZE / 4; ++i)
+        sum = (sum ^ ptr[i]) * 16777619;
+#endif
+    return sum;
+}
+
+static bool merge_same(size_t vaddr, size_t page)
+{
+    bool same = true;
+#ifdef KORA_KRN
+    void *ptr = kmap_atomic(page, VM_RD);
+    same = memcmp((void *)vaddr, ptr, PAGE_SIZE) == 0;
+    kunmap_atomic(ptr);
+#endif
+    return same;
+}
+
+static void merge_copy(size_t dest, size_t src)
+{
+#ifdef KORA_KRN
+    void *ptr1 = kmap_atomic(dest, VM_RW);
+    void *ptr2 = kmap_atomic(src, VM_RD);
+    memcpy(ptr1, ptr2, PAGE_SIZE);
+    kunmap_atomic(ptr2);
+    kunmap_atomic(ptr1);
+#endif
+}
+
+static bool merge_frame_kept(size_t page)
+{
+    page_frame_t *frame = page_frame(page);
+    return frame != NULL && (frame->flags & PGF_MERGED) != 0;
+}
+
+static void merge_item_remove(merge_item_t *item)
+{
+    bbtree_remove(&__merge.items, item->node.value_);
+    kfree(item);
+}
+
+static bool merge_frame_unused(merge_frame_t *mf)
+{
+    return atomic_load(&page_frame(mf->page)->usage) == 1;
+}
+
+static void merge_frame_release(merge_frame_t *mf)
+{
+    __merge.frames--;
+    page_frame(mf->page)->flags &= ~PGF_MERGED;
+    if (page_shared(mf->page, -1))
+        page_release(mf->page);
+    kfree(mf);
+}
+
+/* Release the stable frames only kept by the tree, and forget the checksums
+ * of the pages not seen on the last pass. The merge lock must be held. */
+static void merge_prune(bool all)
+{
+    merge_frame_t *mf = bbtree_first(&__merge.stable, merge_frame_t, node);
+    while (mf != NULL) {
+        merge_frame_t *next = bbtree_next(&mf->node, merge_frame_t, node);
+        merge_frame_t **link = &mf->next;
+        while (*link != NULL) {
+            merge_frame_t *cur = *link;
+            if (all || merge_frame_unused(cur)) {
+                *link = cur->next;
+                merge_frame_release(cur);
+            } else
+                link = &cur->next;
+        }
+        if (all || merge_frame_unused(mf)) {
+            // The next frame of the chain takes its place on the tree
+            bbtree_remove(&__merge.stable, mf->node.value_);
+            if (mf->next != NULL) {
+                mf->next->node.value_ = mf->node.value_;
+                bbtree_insert(&__merge.stable, &mf->next->node);
+            }
+            merge_frame_release(mf);
+        }
+        mf = next;
+    }
+
+    merge_item_t *item = bbtree_first(&__merge.items, merge_item_t, node);
+    while (item != NULL) {
+        merge_item_t *next = bbtree_next(&item->node, merge_item_t, node);
+        if (all || item->pass < __merge.pass)
+            merge_item_remove(item);
+        item = next;
+    }
+}
+
+/* Share the page at this address with an identical one, the space is held
+ * for reading */
+int merge_page(vmsp_t *vmsp, vma_t *vma, size_t vaddr)
+{
+    size_t page = mmu_read(vaddr);
+    if (page == 0 || page == __mmu.zero_page || page_frame(page) == NULL || !page_shared(page, 0))
+        return -1;
+
+    uint32_t sum = merge_checksum(vaddr);
+    splock_lock(&__merge.lock);
+    merge_item_t *item = bbtree_search_eq(&__merge.items, page, merge_item_t, node);
+    if (item == NULL || item->checksum != sum) {
+        // Pages still written are not worth sharing
+        if (item == NULL) {
+            item = kzalloc(sizeof(merge_item_t));
+            item->node.value_ = page;
+            bbtree_insert(&__merge.items, &item->node);
+        }
+        item->checksum = sum;
+        item->pass = __merge.pass;
+        splock_unlock(&__merge.lock);
+        return -1;
+    }
+
+    splock_lock(&vmsp->plock);
+    if (mmu_read(vaddr) != page) {
+        splock_unlock(&vmsp->plock);
+        splock_unlock(&__merge.lock);
+        return -1;
+    }
+    mmu_protect(vaddr, vma->flags & VM_RX);
+    uint32_t check = merge_checksum(vaddr);
+    if (check != sum) {
+        // Written since hashed, the page stays private
+        mmu_protect(vaddr, vma->flags & VM_RWX);
+        splock_unlock(&vmsp->plock);
+        item->checksum = check;
+        item->pass = __merge.pass;
+        splock_unlock(&__merge.lock);
+        return -1;
+    }
+
+    merge_frame_t *head = bbtree_search_eq(&__merge.stable, sum, merge_frame_t, node);
+    merge_frame_t *mf = head;
+    while (mf != NULL && !merge_same(vaddr, mf->page))
+        mf = mf->next;
+    if (mf == NULL) {
+        // The page becomes the stable frame of its content
+        merge_item_remove(item);
+        mf = kzalloc(sizeof(merge_frame_t));
+        mf->node.value_ = sum;
+        mf->page = page;
+        if (head == NULL)
+            bbtree_insert(&__merge.stable, &mf->node);
+        else {
+            mf->next = head->next;
+            head->next = mf;
+        }
+        page_frame(page)->flags |= PGF_MERGED;
+        page_shared(page, 2);
+        __merge.frames++;
+        vmsp->p_size--;
+        vmsp->s_size++;
+        splock_unlock(&vmsp->plock);
+        splock_unlock(&__merge.lock);
+        return -1;
+    }
+
+    merge_item_remove(item);
+    page_shared(mf->page, 1);
+    __merge.merged++;
+    mmu_drop(vaddr);
+    vmsp->t_size += mmu_resolve(vaddr, mf->page, vma->flags & VM_RX);
+    vmsp->p_size--;
+    vmsp->s_size++;
+    splock_unlock(&vmsp->plock);
+    splock_unlock(&__merge.lock);
+    page_release(page);
+    return 0;
+}
+
+/* Scan a space through its own page tables, the task runs on it meanwhile
+ * so the scheduler keeps it installed if we are preempted */
+static int merge_space(vmsp_t *vmsp)
+{
+    task_t *task = __current;
+    vmsp_t *own = task != NULL ? task->vmsp : __mmu.uspace;
+    if (task != NULL)
+        task->vmsp = vmsp;
+    mmu_context(vmsp);
+    int done = vmsp_merge(vmsp);
+    if (task != NULL)
+        task->vmsp = own;
+    mmu_context(own);
+    return done;
+}
+
+/* Merge identical pages of the mergeable areas of every user space */
+int merge_scan()
+{
+    splock_lock(&__merge.lock);
+    merge_prune(false);
+    __merge.pass++;
+    splock_unlock(&__merge.lock);
+    int done = 0;
+    vmsp_t *vmsp = vmsp_next(NULL);
+    while (vmsp != NULL) {
+        done += merge_space(vmsp);
+        vmsp = vmsp_next(vmsp);
+    }
+    return done;
+}
+
+/* Give back private copies of the merged pages of an area */
+void merge_undo(vmsp_t *vmsp, vma_t *vma)
+{
+    assert(vmsp_locked(vmsp));
+    size_t limit = vma->node.value_ + vma->length;
+    for (size_t address = vma->node.value_; address < limit; address += PAGE_SIZE) {
+        size_t old = mmu_read(address);
+        if (old == 0 || !merge_frame_kept(old))
+            continue;
+        size_t page = page_new();
+        if (page == 0)
+            break;
+        merge_copy(page, old);
+        mmu_drop(address);
+        vmsp->t_size += mmu_resolve(address, page, vma->flags & VM_RWX);
+        vmsp->s_size--;
+        vmsp->p_size++;
+        merge_broken(old);
+        if (page_shared(old, -1))
+            page_release(old);
+    }
+}
+
+/* Count a merged page copied back on write */
+void merge_broken(size_t page)
+{
+    if (merge_frame_kept(page))
+        atomic_inc(&__merge.unmerged);
+}
+
+void merge_init()
+{
+    bbtree_init(&__merge.items);
+    bbtree_init(&__merge.stable);
+    splock_init(&__merge.lock);
+}
+
+void merge_sweep()
+{
+    splock_lock(&__merge.lock);
+    merge_prune(true);
+    splock_unlock(&__merge.lock);
+}
+
+void merge_info()
+{
+    if (__merge.frames == 0 && __merge.merged == 0)
+        return;
+    kprintf(KL_DBG, "Merge:  %d stable frames, %d merged, %d unmerged\n",
+        (int)__merge.frames, (int)__merge.merged, (int)atomic_load(&__merge.unmerged));
+}
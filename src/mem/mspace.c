@@ -198,7 +198,7 @@
 ///* Create a memory space for a user application */
 //mspace_t *mspace_create()
 //{
-//	mspace_t *mspace = (mspace_t *)kalloc(sizeof(mspace_t));
+//	mspace_t *mspace = (mspace_t *)kzalloc(sizeof(mspace_t));
 //	bbtree_init(&mspace->tree);
 //	splock_init(&mspace->lock);
 //	mmu_create_uspace(mspace);
@@ -288,7 +288,7 @@
 //		mspace->v_size * 4, mspace->p_size * 4/* / 1024*/,
 //		mspace->s_size * 4, mspace->a_size * 4, mspace->t_size * 4);
 //	kprintf(KL_DBG, "------------------------------------------------\n");
-//	char *buf = kalloc(512);
+//	char *buf = kzalloc(512);
 //	vma_t *vma = bbtree_first(&mspace->tree, vma_t, node);
 //	while (vma) {
 //		vma_print(buf, 512, vma);
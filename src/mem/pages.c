@@ -22,30 +22,400 @@
 #include <kora/mcrs.h>
 #include <kora/llist.h>
 #include <kora/splock.h>
+#include <sys/sem.h>
 #include <assert.h>
 #include <errno.h>
 #include <string.h>
 
-void bitsset(uint8_t *ptr, int start, int count);
-int bitschrz(uint8_t *ptr, int len);
-void bitsclr(uint8_t *ptr, int start, int count);
-bool bitstest(uint8_t *ptr, int start, int count);
+/* Physical pages are managed by a buddy allocator. Memory is cut into zones
+ * of 4 Mb (the largest block we can serve), each holding one free list per
+ * block order. A free block is identified by the state of its first page,
+ * blocks of order `o` are always aligned on `2^o` pages, so the buddy of
+ * the block at index `i` is the block at index `i ^ 2^o`.
+ * Every page is described by a `page_frame_t`, stored by chunks to fit
+ * into `kalloc` blocks.
+ */
+#define ZONE_PAGES  (1 << (PAGE_ORDERS - 1))
+#define FRAME_CHUNK  128
+#define ZONE_FRAME(mz, i)  (&(mz)->frames[(i) / FRAME_CHUNK][(i) % FRAME_CHUNK])
+
+#define PGS_ALLOC  0x00  /* Page is used */
+#define PGS_RESERVED  0x40  /* Page is not handled by this zone */
+#define PGS_FREE  0x80  /* Page is head of a free block, ORed with order */
+#define PGS_MERGED  0xFF  /* Page is inside a free block */
+
+#define PCACHE_CPUS  16
+#define PCACHE_SIZE  64
 
 typedef struct mzone mzone_t;
 struct mzone
 {
-	long offset;
-	long reserved;
-	long available;
-	long count;
+	long offset;  /* Page frame number of the first page of the window */
+	long reserved;  /* Pages of the window before the zone */
+	long available;  /* Pages handled by the zone */
+	long count;  /* Index of the first page after the zone */
 	long free;
 	llnode_t node;
 	splock_t lock;
-	uint8_t *ptr;
+	mzone_t *sibling;  /* Next zone sharing the same window */
+	page_frame_t *frames[ZONE_PAGES / FRAME_CHUNK];  /* Descriptors of each page */
+	llhead_t heads[PAGE_ORDERS];  /* Free lists, one per order */
 	int flags;
 };
 
 llhead_t lzone = INIT_LLHEAD;
+mzone_t **zone_table = NULL;
+long zone_table_len = 0;
+
+static void zone_link(mzone_t *mz, long idx, int order)
+{
+	page_frame_t *frame = ZONE_FRAME(mz, idx);
+	frame->state = PGS_FREE | order;
+	ll_push_front(&mz->heads[order], &frame->node);
+}
+
+static void zone_unlink(mzone_t *mz, long idx, int order)
+{
+	ll_remove(&mz->heads[order], &ZONE_FRAME(mz, idx)->node);
+}
+
+/* Build the free lists of a zone the first time we use it */
+static void zone_setup(mzone_t *mz)
+{
+	long i;
+	for (i = 0; i < ZONE_PAGES / FRAME_CHUNK; ++i)
+		mz->frames[i] = kzalloc(FRAME_CHUNK * sizeof(page_frame_t));
+	for (i = 0; i < ZONE_PAGES; ++i) {
+		page_frame_t *frame = ZONE_FRAME(mz, i);
+		frame->index = (uint16_t)i;
+		frame->state = i < mz->reserved || i >= mz->count ? PGS_RESERVED : PGS_MERGED;
+	}
+
+	/* Cut the zone into the largest aligned blocks */
+	for (i = mz->reserved; i < mz->count; ) {
+		int order = PAGE_ORDERS - 1;
+		while (order > 0 && ((i & ((1 << order) - 1)) != 0 || i + (1 << order) > mz->count))
+			order--;
+		zone_link(mz, i, order);
+		i += 1 << order;
+	}
+}
+
+/* Take a block of the requested order from the zone */
+static long zone_alloc(mzone_t *mz, int order)
+{
+	int k = order;
+	assert(splock_locked(&mz->lock));
+	while (k < PAGE_ORDERS && mz->heads[k].count_ == 0)
+		k++;
+	if (k >= PAGE_ORDERS)
+		return -1;
+
+	long idx = ll_first(&mz->heads[k], page_frame_t, node)->index;
+	zone_unlink(mz, idx, k);
+	/* Split the block and give back the upper halves */
+	while (k > order) {
+		k--;
+		zone_link(mz, idx + (1 << k), k);
+	}
+	page_frame_t *frame = ZONE_FRAME(mz, idx);
+	frame->state = PGS_ALLOC;
+	frame->flags = 0;
+	frame->usage = 0;
+	return idx;
+}
+
+/* Give back a single page to the zone, merging it with its buddies */
+static void zone_free(mzone_t *mz, long idx)
+{
+	int order = 0;
+	assert(splock_locked(&mz->lock));
+	while (order < PAGE_ORDERS - 1) {
+		long buddy = idx ^ (1 << order);
+		if (buddy < mz->reserved || buddy + (1 << order) > mz->count)
+			break;
+		if (ZONE_FRAME(mz, buddy)->state != (PGS_FREE | order))
+			break;
+		zone_unlink(mz, buddy, order);
+		ZONE_FRAME(mz, MAX(idx, buddy))->state = PGS_MERGED;
+		idx = MIN(idx, buddy);
+		order++;
+	}
+	zone_link(mz, idx, order);
+}
+
+static mzone_t *zone_lookup(long pfn)
+{
+	long w = pfn / ZONE_PAGES;
+	if (w < 0 || w >= zone_table_len)
+		return NULL;
+	mzone_t *mz = zone_table[w];
+	while (mz != NULL && (pfn < mz->offset + mz->reserved || pfn >= mz->offset + mz->count))
+		mz = mz->sibling;
+	return mz;
+}
+
+static void zone_register(mzone_t *mz)
+{
+	long w = mz->offset / ZONE_PAGES;
+	if (w >= zone_table_len) {
+		long len = ALIGN_UP(w + 1, 16);
+		mzone_t **table = kzalloc(len * sizeof(mzone_t *));
+		if (zone_table != NULL) {
+			memcpy(table, zone_table, zone_table_len * sizeof(mzone_t *));
+			kfree(zone_table);
+		}
+		zone_table = table;
+		zone_table_len = len;
+	}
+	mz->sibling = zone_table[w];
+	zone_table[w] = mz;
+}
+
+/* Each CPU keeps a magazine of single pages in front of the zones, so
+ * that `page_new` and `page_release` seldom take a zone lock or touch the
+ * global counter. An empty magazine is refilled up to the low watermark,
+ * and drained back down to it once it reaches the high watermark.
+ */
+typedef struct pcache pcache_t;
+struct pcache
+{
+	int count;
+	size_t pages[PCACHE_SIZE];
+	long hits;  /* Pages served from the magazine */
+	long misses;  /* Refills from the zones */
+	long drains;  /* Releases to the zones */
+};
+
+pcache_t page_caches[PCACHE_CPUS];
+int pcache_low = 16;
+int pcache_high = 48;
+
+/* Move up to `n` pages from the zones into the magazine */
+static int pcache_refill(pcache_t *pc, int n)
+{
+	mzone_t *mz;
+	int got = 0;
+	for ll_each(&lzone, mz, mzone_t, node)
+	{
+		if (mz->free == 0)
+			continue;
+		splock_lock(&mz->lock);
+		if (mz->frames[0] == NULL)
+			zone_setup(mz);
+		while (got < n) {
+			long idx = zone_alloc(mz, 0);
+			if (idx < 0)
+				break;
+			pc->pages[pc->count++] = (mz->offset + idx) * PAGE_SIZE;
+			mz->free--;
+			got++;
+		}
+		splock_unlock(&mz->lock);
+		if (got >= n)
+			break;
+	}
+	if (got > 0)
+		atomic_xadd(&__mmu.free_pages, -got);
+	return got;
+}
+
+/* Give back the oldest pages of the magazine, keeping only `keep` of them */
+static void pcache_drain(pcache_t *pc, int keep)
+{
+	mzone_t *locked = NULL;
+	int n = pc->count - keep;
+	if (n <= 0)
+		return;
+	for (int i = 0; i < n; ++i) {
+		long pfn = pc->pages[i] / PAGE_SIZE;
+		mzone_t *mz = zone_lookup(pfn);
+		if (mz != locked) {
+			if (locked != NULL)
+				splock_unlock(&locked->lock);
+			splock_lock(&mz->lock);
+			locked = mz;
+		}
+		assert(ZONE_FRAME(mz, pfn - mz->offset)->state == PGS_ALLOC);
+		zone_free(mz, pfn - mz->offset);
+		mz->free++;
+	}
+	splock_unlock(&locked->lock);
+	memmove(pc->pages, &pc->pages[n], keep * sizeof(size_t));
+	pc->count = keep;
+	pc->drains++;
+	atomic_xadd(&__mmu.free_pages, n);
+}
+
+/* Pages cleared ahead of time, to keep the zeroing cost out of the fault
+ * path. The pool is refilled by the `kzeroing` task while the CPU is idle.
+ */
+#define ZPOOL_SIZE  64
+
+size_t zpool_pages[ZPOOL_SIZE];
+int zpool_count = 0;
+splock_t zpool_lock = INIT_SPLOCK;
+
+/* Take a page already filled with zeros, return 0 if the pool is empty */
+size_t page_zero_take()
+{
+	size_t page = 0;
+	splock_lock(&zpool_lock);
+	if (zpool_count > 0)
+		page = zpool_pages[--zpool_count];
+	splock_unlock(&zpool_lock);
+	return page;
+}
+
+/* Clear up to `count` pages and add them to the pool */
+int page_zero_fill(int count)
+{
+	int done = 0;
+	while (done < count && zpool_count < ZPOOL_SIZE && !page_reclaim_needed()) {
+		size_t page = page_new();
+		if (page == 0)
+			break;
+		void *ptr = kmap_atomic(page, VM_RW);
+#ifdef KORA_KRN
+		memset(ptr, 0, PAGE_SIZE);
+#endif
+		kunmap_atomic(ptr);
+		splock_lock(&zpool_lock);
+		if (zpool_count >= ZPOOL_SIZE) {
+			splock_unlock(&zpool_lock);
+			page_release(page);
+			break;
+		}
+		zpool_pages[zpool_count++] = page;
+		splock_unlock(&zpool_lock);
+		done++;
+	}
+	return done;
+}
+
+/* Give back up to `count` pages of the pool, return how many were released */
+static int zpool_shrink(int count)
+{
+	int done = 0;
+	splock_lock(&zpool_lock);
+	while (zpool_count > 0 && done < count) {
+		page_release(zpool_pages[--zpool_count]);
+		done++;
+	}
+	splock_unlock(&zpool_lock);
+	return done;
+}
+
+static void zpool_flush()
+{
+	zpool_shrink(ZPOOL_SIZE);
+}
+
+/* Caches owned by other modules (page cache, file nodes...) register a
+ * shrinker able to give pages back. Once free pages fall under the low
+ * watermark the `kreclaim` task calls them until the high watermark is
+ * reached again. An allocation that fails runs an atomic pass itself, then
+ * if its caller can sleep, wakes the task and waits for its passes before
+ * giving up.
+ */
+#define SHRINKER_MAX  8
+#define RECLAIM_TRIES  4
+
+page_shrink_t page_shrinkers[SHRINKER_MAX];
+int page_shrinker_count = 0;
+long reclaim_low = 0;
+long reclaim_high = 0;
+atomic_int reclaim_wanted = 0;
+atomic_int reclaim_waiters = 0;
+task_t *reclaim_task = NULL;
+sem_t reclaim_sem;  /* Wakes the reclaim task */
+sem_t reclaim_done;  /* Wakes allocations waiting for a pass */
+splock_t shrinker_lock = INIT_SPLOCK;
+
+/* Register a callback used to release pages under memory pressure */
+void page_shrinker(page_shrink_t shrink)
+{
+	splock_lock(&shrinker_lock);
+	assert(page_shrinker_count < SHRINKER_MAX);
+	page_shrinkers[page_shrinker_count++] = shrink;
+	splock_unlock(&shrinker_lock);
+}
+
+static long reclaim_watermark(bool high)
+{
+	long low = reclaim_low != 0 ? reclaim_low : MAX((long)__mmu.pages_amount / 64, PCACHE_SIZE);
+	if (!high)
+		return low;
+	return reclaim_high != 0 ? reclaim_high : 2 * low;
+}
+
+/* Check if free pages are under the low watermark or an allocation failed */
+bool page_reclaim_needed()
+{
+	return reclaim_wanted != 0 || __mmu.free_pages < reclaim_watermark(false);
+}
+
+/* Ask every shrinker to release objects until `count` are gone, or up to
+ * the high watermark if `count` is zero. Return the number released. */
+int page_reclaim(int count, int flags)
+{
+	if (count <= 0)
+		count = MAX(reclaim_watermark(true) - __mmu.free_pages, 0);
+	int done = zpool_shrink(count);
+	bool progress = true;
+	while (done < count && progress) {
+		progress = false;
+		for (int i = 0; i < page_shrinker_count && done < count; ++i) {
+			int n = page_shrinkers[i](count - done, flags);
+			if (n > 0) {
+				done += n;
+				progress = true;
+			}
+		}
+	}
+	if ((flags & PGR_ATOMIC) == 0)
+		reclaim_wanted = 0;
+	return done;
+}
+
+/* Block the reclaim task until pages are needed, or `timeout` elapsed
+ * since an atomic caller can only raise the flag without waking it */
+void page_reclaim_wait(long timeout)
+{
+	if (reclaim_task == NULL) {
+		sem_init(&reclaim_sem, 0);
+		sem_init(&reclaim_done, 0);
+		reclaim_task = __current;
+	}
+	int waiters = atomic_xchg(&reclaim_waiters, 0);
+	if (waiters > 0)
+		sem_release_many(&reclaim_done, waiters);
+	struct timespec xt;
+	xt.tv_sec = timeout / 1000000;
+	xt.tv_nsec = (timeout % 1000000) * 1000;
+	sem_timedacquire(&reclaim_sem, &xt);
+}
+
+/* Wake the reclaim task and wait for the end of its next pass */
+static void page_reclaim_sync()
+{
+	atomic_inc(&reclaim_waiters);
+	reclaim_wanted = 1;
+	sem_release(&reclaim_sem);
+	sem_acquire(&reclaim_done);
+}
+
+/* Change the watermarks of the reclaim task, zero restore the defaults */
+int page_reclaim_tune(long low, long high)
+{
+	if (low < 0 || high < 0 || (low == 0) != (high == 0) || (low != 0 && high <= low)) {
+		errno = EINVAL;
+		return -1;
+	}
+	reclaim_low = low;
+	reclaim_high = high;
+	return 0;
+}
 
 void page_range(long long base, long long length)
 {
@@ -62,33 +432,41 @@ void page_range(long long base, long long length)
 	__mmu.pages_amount += count;
 	__mmu.free_pages += count;
 	while (count > 0) {
-		int i = start / 8;
-		int j = start % 8;
-		int pgs = count;
-		if (pgs + j > PAGE_SIZE * 4)
-			pgs = PAGE_SIZE * 4 - j;
-		mzone_t *zn = kalloc(sizeof(mzone_t));
-		zn->offset = i * 8;
+		long i = ALIGN_DW(start, ZONE_PAGES);
+		long j = start - i;
+		long pgs = MIN(count, ZONE_PAGES - j);
+		mzone_t *zn = kzalloc(sizeof(mzone_t));
+		zn->offset = i;
 		zn->reserved = j;
 		zn->available = pgs;
-		zn->count = ALIGN_UP(pgs + j, 8);
+		zn->count = j + pgs;
 		zn->free = pgs;
 		ll_append(&lzone, &zn->node);
-		kprintf(-1, "Found %d pages at %d[%d.%d]\n", pgs, start, i, j);
+		zone_register(zn);
+		kprintf(-1, "Found %d pages at %d[%d.%d]\n", (int)pgs, (int)start, (int)i, (int)j);
 		count -= pgs;
-		start = zn->offset + zn->count;
+		start += pgs;
 	}
 }
 
 void page_teardown()
 {
 	mzone_t *mz;
+	zpool_flush();
+	page_shrinker_count = 0;
+	for (int i = 0; i < PCACHE_CPUS; ++i) {
+		pcache_drain(&page_caches[i], 0);
+		memset(&page_caches[i], 0, sizeof(pcache_t));
+	}
+
 	for ll_each(&lzone, mz, mzone_t, node)
 	{
 		splock_lock(&mz->lock);
-		if (mz->available == mz->free && mz->ptr) {
-			kfree(mz->ptr);
-			mz->ptr = NULL;
+		if (mz->available == mz->free && mz->frames[0]) {
+			for (int i = 0; i < ZONE_PAGES / FRAME_CHUNK; ++i) {
+				kfree(mz->frames[i]);
+				mz->frames[i] = NULL;
+			}
 		}
 		splock_unlock(&mz->lock);
 	}
@@ -99,41 +477,136 @@ void page_teardown()
 		it = ll_next(&it->node, mzone_t, node);
 		kfree(mz);
 	}
+	lzone.first_ = NULL;
+	lzone.last_ = NULL;
+	lzone.count_ = 0;
+	if (zone_table != NULL)
+		kfree(zone_table);
+	zone_table = NULL;
+	zone_table_len = 0;
 }
 
+static bool zone_match(mzone_t *mz, int zone)
+{
+	if (zone == PGZ_DMA)
+		return mz->offset + mz->count <= PGZ_DMA_LIMIT / PAGE_SIZE;
+	return true;
+}
 
-/* Allocate a single page for the system and return it's physical address */
-size_t page_new()
+/* Look for count pages in continuous memory */
+size_t page_get(int zone, int count)
 {
 	mzone_t *mz;
+	int order = 0;
+	assert(count > 0);
+	while ((1 << order) < count)
+		order++;
+	if (order >= PAGE_ORDERS) {
+		errno = E2BIG;
+		return 0;
+	}
+
 	/* Look on each memory zone */
 	for ll_each(&lzone, mz, mzone_t, node)
 	{
+		if (mz->free < count || !zone_match(mz, zone))
+			continue;
 		splock_lock(&mz->lock);
-		if (mz->free == 0) {
+		/* Build free lists if required */
+		if (mz->frames[0] == NULL)
+			zone_setup(mz);
+
+		long idx = zone_alloc(mz, order);
+		if (idx < 0) {
 			splock_unlock(&mz->lock);
 			continue;
 		}
-		/* Allocate bitmap if required */
-		if (mz->ptr == NULL) {
-			mz->ptr = kalloc(mz->count / 8);
-			memset(mz->ptr, 0xFF, mz->count / 8);
-			bitsclr(mz->ptr, mz->reserved, mz->available);
+		/* Every page of the run is released independently */
+		for (long i = 1; i < count; ++i) {
+			page_frame_t *frame = ZONE_FRAME(mz, idx + i);
+			frame->state = PGS_ALLOC;
+			frame->flags = 0;
+			frame->usage = 0;
 		}
-
-		/* Look for available page */
-		long idx = bitschrz(mz->ptr, mz->count);
-		assert(idx >= 0);
-		mz->free--;
-		atomic_dec(&__mmu.free_pages);
-		bitsset(mz->ptr, idx, 1);
-		idx += mz->offset;
+		for (long i = count; i < (1 << order); ++i)
+			zone_free(mz, idx + i);
+		mz->free -= count;
+		atomic_xadd(&__mmu.free_pages, -count);
 		splock_unlock(&mz->lock);
-		// kprintf(-1, "===> %p (%d)\n", (size_t)(idx * PAGE_SIZE), __mmu.free_pages);
-		return idx * PAGE_SIZE;
+		return (mz->offset + idx) * PAGE_SIZE;
+	}
+
+	/* Pages kept by our cache might prevent blocks from merging */
+	irq_disable();
+	pcache_t *pc = &page_caches[cpu_no() % PCACHE_CPUS];
+	if (pc->count > 0) {
+		pcache_drain(pc, 0);
+		irq_enable();
+		return page_get(zone, count);
 	}
+	irq_enable();
+	errno = ENOMEM;
+	return 0;
+}
+
+/* Take a page from the per-CPU cache, refilled from the zones when empty */
+static size_t page_pop()
+{
+	size_t page = 0;
+	irq_disable();
+	pcache_t *pc = &page_caches[cpu_no() % PCACHE_CPUS];
+	if (pc->count > 0) {
+		pc->hits++;
+	} else {
+		pc->misses++;
+		pcache_refill(pc, pcache_low);
+	}
+	if (pc->count > 0)
+		page = pc->pages[--pc->count];
+	irq_enable();
+	return page;
+}
+
+/* Allocate a single page for the system and return it's physical address,
+ * or zero with `ENOMEM` once reclaim can't find any page */
+size_t page_new()
+{
+	size_t page = page_pop();
+	for (int i = 0; page == 0 && i < RECLAIM_TRIES; ++i) {
+		// Raise the flag for the reclaim task and release some pages ourself
+		reclaim_wanted = 1;
+		if (page_reclaim(pcache_low, PGR_ATOMIC) == 0)
+			break;
+		page = page_pop();
+	}
+
+	// The reclaim task can sleep on shrinkers, wait for its passes
+	bool sleep = reclaim_task != NULL && reclaim_task != __current && can_sleep();
+	for (int i = 0; page == 0 && sleep && i < RECLAIM_TRIES; ++i) {
+		page_reclaim_sync();
+		page = page_pop();
+	}
+	if (page != 0)
+		return page;
 
 	kprintf(KL_ERR, "Error, no more pages available\n");
+	errno = ENOMEM;
+	return 0;
+}
+
+/* Allocate a page for the MMU tables, whose callers have no way to report
+ * a failure: keep waiting on reclaim while we can sleep, stop otherwise */
+size_t page_new_table()
+{
+	for (;;) {
+		size_t page = page_new();
+		if (page != 0)
+			return page;
+		if (reclaim_task == NULL || reclaim_task == __current || !can_sleep())
+			break;
+		page_reclaim_sync();
+	}
+	kprintf(KL_ERR, "Unable to allocate a page for the MMU tables\n");
 	for (;;);
 }
 
@@ -141,69 +614,72 @@ size_t page_new()
 /* Mark a physique page, returned by `page_new`, as available again */
 void page_release(size_t paddress)
 {
-	mzone_t *mz;
-	long idx = paddress / PAGE_SIZE;
-	/* Look on each memory zone */
-	for ll_each(&lzone, mz, mzone_t, node)
-	{
-		splock_lock(&mz->lock);
-		if (idx < mz->offset + mz->reserved || idx >= mz->offset + mz->reserved + mz->available) {
-			splock_unlock(&mz->lock);
-			continue;
-		}
-		assert(mz->ptr != NULL);
-		assert(bitstest(mz->ptr, idx - mz->offset, 1));
-		/* Release page */
-		bitsclr(mz->ptr, idx - mz->offset, 1);
-		mz->free++;
-		atomic_inc(&__mmu.free_pages);
-		splock_unlock(&mz->lock);
-		// kprintf(-1, "<=== %p (%d)\n", (size_t)(idx * PAGE_SIZE), __mmu.free_pages);
+	long pfn = paddress / PAGE_SIZE;
+	mzone_t *mz = zone_lookup(pfn);
+	if (mz == NULL) {
+		kprintf(KL_ERR, "Page '%p' provided to page_release is not referenced.\n", paddress);
 		return;
 	}
-	kprintf(KL_ERR, "Page '%p' provided to page_release is not referenced.\n", paddress);
+
+	irq_disable();
+	pcache_t *pc = &page_caches[cpu_no() % PCACHE_CPUS];
+	pc->pages[pc->count++] = paddress;
+	if (pc->count >= pcache_high)
+		pcache_drain(pc, pcache_low);
+	irq_enable();
+}
+
+/* Change the watermarks of the per-CPU caches */
+int page_cache_tune(int low, int high)
+{
+	if (low <= 0 || high <= low || high > PCACHE_SIZE) {
+		errno = EINVAL;
+		return -1;
+	}
+	pcache_low = low;
+	pcache_high = high;
+	return 0;
+}
+
+void page_cache_info()
+{
+	for (int i = 0; i < PCACHE_CPUS; ++i) {
+		pcache_t *pc = &page_caches[i];
+		if (pc->hits + pc->misses == 0)
+			continue;
+		kprintf(KL_DBG, "PageCache CPU%d:  %d pages, %d hits, %d misses, %d drains\n", i,
+			pc->count, (int)pc->hits, (int)pc->misses, (int)pc->drains);
+	}
 }
 
 
 /* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
 
-typedef struct page_sharing_entry
+/* Return the descriptor of a physical page */
+page_frame_t *page_frame(size_t paddress)
 {
-	size_t page;
-	int count;
-} page_sharing_entry_t;
-
+	long pfn = paddress / PAGE_SIZE;
+	mzone_t *mz = zone_lookup(pfn);
+	if (mz == NULL || mz->frames[0] == NULL)
+		return NULL;
+	return ZONE_FRAME(mz, pfn - mz->offset);
+}
 
-bool page_shared(page_sharing_t *share, size_t page, int count)
+bool page_shared(size_t page, int count)
 {
-	if (share == NULL) {
+	page_frame_t *frame = page_frame(page);
+	if (frame == NULL) {
 		assert(count == 0);
 		return true;
 	}
-	bool last = false;
-	splock_lock(&share->lock);
-	page_sharing_entry_t *ps = hmp_get(&share->map, (char *)&page, sizeof(size_t));
-	if (ps == NULL) {
-		if (count == 0) {
-			splock_unlock(&share->lock);
-			return true;
-		}
-		assert(count > 0);
-		ps = kalloc(sizeof(page_sharing_entry_t));
-		ps->page = page;
-		ps->count = count;
-		hmp_put(&share->map, (char *)&page, sizeof(size_t), ps);
-	} else {
-		ps->count += count;
-		if (ps->count <= 0) {
-			hmp_remove(&share->map, (char *)&page, sizeof(size_t));
-			last = true;
-			kfree(ps);
-		}
-	}
-	kprintf(-1, "- shared page %p (%d)\n", (void *)page, last ? 0 : ps->count);
-	splock_unlock(&share->lock);
-	return last;
+	if (count == 0)
+		return atomic_load(&frame->usage) == 0;
+
+	int usage = atomic_xadd(&frame->usage, count) + count;
+	assert(usage >= 0);
+	if (usage > 0 || count > 0)
+		return false;
+	return true;
 }
 
 /* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
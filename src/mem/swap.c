@@ -0,0 +1,445 @@
+/*
+ *      This file is part of the KoraOS project.
+ *  Copyright (C) 2015-2021  <Fabien Bavent>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   - - - - - - - - - - - - - - -
+ */
+#include <kernel/stdc.h>
+#include <kernel/memory.h>
+#include <kernel/vfs.h>
+#include <kora/bbtree.h>
+#include <kora/splock.h>
+#include <bits/atomic.h>
+#include <errno.h>
+#include <assert.h>
+
+/* Anonymous pages are moved to a single swap area, split in page sized
+ * slots. Each slot keeps a usage counter, as cloned spaces share them.
+ * The slot zero is never used, so a null slot means no swap entry.
+ * Before the device, pages are offered to the compressed store (zswap.c).
+ *
+ * The swap cache holds the pages waiting to be written on their slot, and
+ * the ones read ahead. A fault looks into the cache before doing any I/O.
+ */
+#define SWAP_CHUNK  ((long)(PAGE_SIZE / sizeof(uint32_t)))  /* Slots per chunk of the usage map */
+#define SWAP_CHUNKS  256
+#define SWAP_CLUSTER  8  /* Read-ahead window, in slots */
+
+#define SWAP_REF(s)  (__swap.map[(s) / SWAP_CHUNK][(s) % SWAP_CHUNK])
+
+typedef struct swap_page swap_page_t;
+typedef struct swap_entry swap_entry_t;
+
+struct swap_page
+{
+    bbnode_t node;  /* Slot number */
+    size_t page;
+    bool dirty;  /* Not yet written on its slot */
+    bool busy;  /* Write in progress */
+};
+
+struct swap_entry
+{
+    bbnode_t node;  /* Virtual address of the page */
+    long slot;
+};
+
+struct swap_area
+{
+    inode_t *ino;
+    long slots;
+    long used;
+    long cursor;  /* Next slot to look at, keeps evicted pages close */
+    uint32_t *map[SWAP_CHUNKS];  /* Users of each slot, as many as the spaces sharing it */
+    bbtree_t cache;
+    long cached;
+    splock_t lock;
+    mtx_t mtx;  /* Serialize swap I/O */
+    long reads;
+    long writes;
+    long aheads;
+    long hits;
+};
+
+struct swap_area __swap;
+
+
+static int swap_io(long slot, size_t page, int flags)
+{
+#ifdef KORA_KRN
+    char tmp[16];
+    void *ptr = kmap(PAGE_SIZE, NULL, page, VMA_PHYS | VM_RW);
+    xoff_t off = (xoff_t)slot * PAGE_SIZE;
+    int ret;
+    if (flags & VM_WR)
+        ret = vfs_write(__swap.ino, ptr, PAGE_SIZE, off, 0);
+    else
+        ret = vfs_read(__swap.ino, ptr, PAGE_SIZE, off, 0);
+    kunmap(ptr, PAGE_SIZE);
+    if (ret != PAGE_SIZE) {
+        kprintf(KL_ERR, "Error on swap %s, slot %d\n", vfs_inokey(__swap.ino, tmp), slot);
+        return -1;
+    }
+#endif
+    return 0;
+}
+
+static void swap_copy(size_t dest, size_t src)
+{
+#ifdef KORA_KRN
+    void *ptr1 = kmap_atomic(dest, VM_RW);
+    void *ptr2 = kmap_atomic(src, VM_RD);
+    memcpy(ptr1, ptr2, PAGE_SIZE);
+    kunmap_atomic(ptr2);
+    kunmap_atomic(ptr1);
+#endif
+}
+
+/* Look for the cached page of a slot, the swap lock must be held */
+static swap_page_t *swap_cache_find(long slot)
+{
+    return bbtree_search_eq(&__swap.cache, slot, swap_page_t, node);
+}
+
+static void swap_cache_insert(long slot, size_t page, bool dirty)
+{
+    swap_page_t *sp = kzalloc(sizeof(swap_page_t));
+    sp->node.value_ = slot;
+    sp->page = page;
+    sp->dirty = dirty;
+    bbtree_insert(&__swap.cache, &sp->node);
+    __swap.cached++;
+}
+
+static size_t swap_cache_remove(swap_page_t *sp)
+{
+    size_t page = sp->page;
+    bbtree_remove(&__swap.cache, sp->node.value_);
+    __swap.cached--;
+    kfree(sp);
+    return page;
+}
+
+/* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
+
+/* Use an inode as backing store for anonymous pages */
+int swap_activate(inode_t *ino)
+{
+    long slots = MIN((long)(ino->length / PAGE_SIZE), SWAP_CHUNKS * SWAP_CHUNK);
+    if (slots < 2) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    splock_lock(&__swap.lock);
+    if (__swap.ino != NULL) {
+        splock_unlock(&__swap.lock);
+        errno = EBUSY;
+        return -1;
+    }
+    __swap.ino = vfs_open_inode(ino);
+    __swap.slots = slots;
+    __swap.used = 0;
+    __swap.cursor = 1;
+    for (long i = 0; i < slots; i += SWAP_CHUNK)
+        __swap.map[i / SWAP_CHUNK] = kzalloc(PAGE_SIZE);
+    bbtree_init(&__swap.cache);
+    mtx_init(&__swap.mtx, mtx_plain);
+    splock_unlock(&__swap.lock);
+    kprintf(KL_MSG, "Swap activated, %d pages\n", slots - 1);
+    return 0;
+}
+
+/* Stop using the swap area, pages still swapped out must be freed first */
+int swap_deactivate()
+{
+    splock_lock(&__swap.lock);
+    if (__swap.ino == NULL) {
+        splock_unlock(&__swap.lock);
+        errno = EINVAL;
+        return -1;
+    } else if (__swap.used != 0 || __swap.cached != 0) {
+        splock_unlock(&__swap.lock);
+        errno = EBUSY;
+        return -1;
+    }
+
+    for (long i = 0; i < __swap.slots; i += SWAP_CHUNK) {
+        kfree(__swap.map[i / SWAP_CHUNK]);
+        __swap.map[i / SWAP_CHUNK] = NULL;
+    }
+    inode_t *ino = __swap.ino;
+    __swap.ino = NULL;
+    __swap.slots = 0;
+    mtx_destroy(&__swap.mtx);
+    splock_unlock(&__swap.lock);
+    vfs_close_inode(ino);
+    return 0;
+}
+
+/* Take a free slot for the page and keep it in cache until written */
+long swap_out(size_t page)
+{
+    splock_lock(&__swap.lock);
+    if (__swap.ino == NULL || __swap.used + 1 >= __swap.slots) {
+        splock_unlock(&__swap.lock);
+        return 0;
+    }
+
+    // Slots of a freed page might still wait for the end of a write
+    long slot = __swap.cursor;
+    for (long n = 1; SWAP_REF(slot) != 0 || swap_cache_find(slot) != NULL; ++n) {
+        if (n >= __swap.slots) {
+            splock_unlock(&__swap.lock);
+            return 0;
+        }
+        if (++slot >= __swap.slots)
+            slot = 1;
+    }
+    SWAP_REF(slot) = 1;
+    __swap.used++;
+    __swap.cursor = slot + 1 < __swap.slots ? slot + 1 : 1;
+    swap_cache_insert(slot, page, true);
+    splock_unlock(&__swap.lock);
+    return slot;
+}
+
+/* Add a user to a slot */
+void swap_dup(long slot)
+{
+    splock_lock(&__swap.lock);
+    assert(SWAP_REF(slot) > 0 && SWAP_REF(slot) < UINT32_MAX);
+    SWAP_REF(slot)++;
+    splock_unlock(&__swap.lock);
+}
+
+/* Remove a user of a slot, the last one release the slot */
+void swap_free(long slot)
+{
+    size_t page = 0;
+    splock_lock(&__swap.lock);
+    assert(SWAP_REF(slot) > 0);
+    if (--SWAP_REF(slot) == 0) {
+        __swap.used--;
+        swap_page_t *sp = swap_cache_find(slot);
+        if (sp != NULL && !sp->busy)
+            page = swap_cache_remove(sp);
+        zswap_drop(slot);
+    }
+    splock_unlock(&__swap.lock);
+    if (page != 0)
+        page_release(page);
+}
+
+static void swap_readahead(long slot)
+{
+    long base = ALIGN_DW(slot, SWAP_CLUSTER);
+    for (long i = base; i < base + SWAP_CLUSTER && i < __swap.slots; ++i) {
+        if (i == 0 || i == slot)
+            continue;
+        splock_lock(&__swap.lock);
+        bool wanted = SWAP_REF(i) != 0 && swap_cache_find(i) == NULL && !zswap_lookup(i);
+        splock_unlock(&__swap.lock);
+        if (!wanted)
+            continue;
+
+        size_t page = page_new();
+        if (page == 0)
+            break;
+        if (swap_io(i, page, VM_RD) != 0) {
+            page_release(page);
+            break;
+        }
+        splock_lock(&__swap.lock);
+        if (SWAP_REF(i) != 0 && swap_cache_find(i) == NULL) {
+            swap_cache_insert(i, page, false);
+            __swap.aheads++;
+            page = 0;
+        }
+        splock_unlock(&__swap.lock);
+        if (page != 0)
+            page_release(page);
+    }
+}
+
+/* Get back the content of a slot into a new page. Without blocking, only
+ * a page in cache can be returned. */
+size_t swap_in(long slot, bool blocking)
+{
+    size_t page = 0;
+    if (blocking)
+        mtx_lock(&__swap.mtx);
+    splock_lock(&__swap.lock);
+    swap_page_t *sp = swap_cache_find(slot);
+    if (sp != NULL && !sp->busy && SWAP_REF(slot) == 1) {
+        page = swap_cache_remove(sp);
+        __swap.hits++;
+    }
+    splock_unlock(&__swap.lock);
+    if (page == 0)
+        page = zswap_load(slot);
+    if (page != 0 || !blocking) {
+        if (blocking)
+            mtx_unlock(&__swap.mtx);
+        return page;
+    }
+
+    // Writes are done under the mutex, the cache is stable
+    page = page_new();
+    if (page == 0) {
+        mtx_unlock(&__swap.mtx);
+        return 0;
+    }
+    splock_lock(&__swap.lock);
+    sp = swap_cache_find(slot);
+    size_t src = sp != NULL ? sp->page : 0;
+    splock_unlock(&__swap.lock);
+    if (src != 0) {
+        swap_copy(page, src);
+        __swap.hits++;
+    } else if (swap_io(slot, page, VM_RD) == 0) {
+        __swap.reads++;
+        swap_readahead(slot);
+    } else {
+        page_release(page);
+        page = 0;
+    }
+    mtx_unlock(&__swap.mtx);
+    return page;
+}
+
+/* Write the evicted pages on their slots, then release them */
+static int swap_writeback()
+{
+    int done = 0;
+    mtx_lock(&__swap.mtx);
+    for (;;) {
+        splock_lock(&__swap.lock);
+        swap_page_t *sp = bbtree_first(&__swap.cache, swap_page_t, node);
+        while (sp != NULL && !sp->dirty)
+            sp = bbtree_next(&sp->node, swap_page_t, node);
+        if (sp == NULL) {
+            splock_unlock(&__swap.lock);
+            break;
+        }
+        sp->busy = true;
+        splock_unlock(&__swap.lock);
+
+        // The compressed store is tried before the device
+        long slot = sp->node.value_;
+        bool stored = zswap_store(slot, sp->page);
+        int ret = stored ? 0 : swap_io(slot, sp->page, VM_WR);
+
+        splock_lock(&__swap.lock);
+        sp->busy = false;
+        sp->dirty = ret != 0;
+        size_t page = 0;
+        if (ret == 0 && !stored)
+            __swap.writes++;
+        if (stored && SWAP_REF(slot) == 0)
+            zswap_drop(slot);
+        if (ret == 0 || SWAP_REF(sp->node.value_) == 0) {
+            page = swap_cache_remove(sp);
+            done++;
+        }
+        splock_unlock(&__swap.lock);
+        if (page != 0)
+            page_release(page);
+        else
+            break;
+    }
+    mtx_unlock(&__swap.mtx);
+    return done;
+}
+
+/* Drop pages read ahead but never used */
+static int swap_cache_shrink(int count)
+{
+    int done = 0;
+    splock_lock(&__swap.lock);
+    swap_page_t *sp = bbtree_first(&__swap.cache, swap_page_t, node);
+    while (sp != NULL && done < count) {
+        swap_page_t *next = bbtree_next(&sp->node, swap_page_t, node);
+        if (!sp->dirty && !sp->busy) {
+            page_release(swap_cache_remove(sp));
+            done++;
+        }
+        sp = next;
+    }
+    splock_unlock(&__swap.lock);
+    return done;
+}
+
+/* Shrinker of anonymous memory. The MMU only reaches the current space, so
+ * the reclaim task, which runs on no space of its own, only writes back and
+ * drops the swap cache. Pages are evicted by the faulting tasks, from their
+ * own space (see `vmsp_resolve`). */
+int swap_shrink(int count, int flags)
+{
+    if ((flags & PGR_ATOMIC) || __swap.ino == NULL)
+        return 0;
+    int done = swap_cache_shrink(count);
+    if (done < count && (flags & PGR_USPACE) && __mmu.uspace != NULL)
+        vmsp_evict(__mmu.uspace, count - done);
+    return done + swap_writeback();
+}
+
+void swap_info()
+{
+    if (__swap.ino == NULL)
+        return;
+    long total = __swap.slots - 1;
+    kprintf(KL_DBG, "SwapTotal:     %9s (%dK)\n", sztoa(total * PAGE_SIZE), total * 4);
+    kprintf(KL_DBG, "SwapFree:      %9s (%dK)\n", sztoa((total - __swap.used) * PAGE_SIZE), (total - __swap.used) * 4);
+    kprintf(KL_DBG, "SwapCached:    %9s (%dK)\n", sztoa(__swap.cached * PAGE_SIZE), __swap.cached * 4);
+    kprintf(KL_DBG, "Swap:  %d reads, %d writes, %d read ahead, %d cache hits\n",
+        (int)__swap.reads, (int)__swap.writes, (int)__swap.aheads, (int)__swap.hits);
+    zswap_info();
+}
+
+/* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
+
+/* Return the slot holding the page at this address */
+long swap_lookup(vmsp_t *vmsp, size_t vaddr)
+{
+    assert(splock_locked(&vmsp->plock) || vmsp_locked(vmsp));
+    swap_entry_t *entry = bbtree_search_eq(&vmsp->swaps, vaddr, swap_entry_t, node);
+    return entry != NULL ? entry->slot : 0;
+}
+
+/* Record the slot holding the page at this address */
+void swap_attach(vmsp_t *vmsp, size_t vaddr, long slot)
+{
+    swap_entry_t *entry = kzalloc(sizeof(swap_entry_t));
+    entry->node.value_ = vaddr;
+    entry->slot = slot;
+    bbtree_insert(&vmsp->swaps, &entry->node);
+    vmsp->w_size++;
+}
+
+/* Forget the slot of a page at this address, and return it */
+long swap_detach(vmsp_t *vmsp, size_t vaddr)
+{
+    assert(splock_locked(&vmsp->plock) || vmsp_locked(vmsp));
+    swap_entry_t *entry = bbtree_search_eq(&vmsp->swaps, vaddr, swap_entry_t, node);
+    if (entry == NULL)
+        return 0;
+    long slot = entry->slot;
+    bbtree_remove(&vmsp->swaps, vaddr);
+    kfree(entry);
+    vmsp->w_size--;
+    return slot;
+}
@@ -195,7 +195,7 @@
 //    size_t pages = vma->length / PAGE_SIZE;
 //    if (model->cow_reg)
 //        pages = model->cow_reg->pages_count;
-//    vma_cow_reg_t *reg = kalloc(sizeof(vma_cow_reg_t) + pages * sizeof(size_t));
+//    vma_cow_reg_t *reg = kzalloc(sizeof(vma_cow_reg_t) + pages * sizeof(size_t));
 //    reg->rcu = 2;
 //    vma->cow_reg = reg;
 //    if (model->cow_reg) {
@@ -548,7 +548,7 @@
 //    int type = flags & VMA_TYPE;
 //    int access = flags & (VM_RW | VM_EX | VM_RESOLVE | VM_SHARED | VM_UNCACHABLE);
 //
-//    vma_t *vma = (vma_t *)kalloc(sizeof(vma_t));
+//    vma_t *vma = (vma_t *)kzalloc(sizeof(vma_t));
 //    vma->mspace = mspace;
 //    vma->node.value_ = address;
 //    vma->length = length;
@@ -606,7 +606,7 @@
 //    char tmp[32];
 //    // assert(splock_locked(&mspace->lock));
 //    
-//    vma_t *vma = (vma_t *)kalloc(sizeof(vma_t));
+//    vma_t *vma = (vma_t *)kzalloc(sizeof(vma_t));
 //    vma->mspace = mspace;
 //    vma->node.value_ = model->node.value_;
 //    vma->length = model->length;
@@ -635,7 +635,7 @@
 //    kprintf(KL_VMA, "On %s%p, split vma %s\n", VMS_NAME(mspace), mspace, area->ops->print(area, tmp, 32));
 //
 //    // Alloc a second one
-//    vma_t *vma = (vma_t *)kalloc(sizeof(vma_t));
+//    vma_t *vma = (vma_t *)kzalloc(sizeof(vma_t));
 //    vma->mspace = mspace;
 //    vma->node.value_ = area->node.value_ + length;
 //    vma->flags = area->flags;
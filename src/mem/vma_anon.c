@@ -8,21 +8,64 @@
 #include <assert.h>
 
 
+/* The slot is only released once the page is mapped, see vma_resolve_blank */
+static size_t vma_fetch_swap(vmsp_t *vmsp, size_t vaddr, long slot, bool blocking)
+{
+    size_t page = swap_in(slot, false);
+    if (page == 0 && blocking) {
+        vmsp_rdunlock(vmsp);
+        page = swap_in(slot, true);
+        vmsp_rdlock(vmsp);
+    }
+    return page;
+}
+
 size_t vma_fetch_blank(vmsp_t *vmsp, vma_t *vma, xoff_t offset, bool blocking)
 {
     size_t page;
+    if (vmsp->w_size != 0) {
+        size_t vaddr = vma->node.value_ + (size_t)(offset - vma->offset);
+        splock_lock(&vmsp->plock);
+        long slot = swap_lookup(vmsp, vaddr);
+        splock_unlock(&vmsp->plock);
+        if (slot != 0)
+            return vma_fetch_swap(vmsp, vaddr, slot, blocking);
+    }
+
     if (vma->flags & VM_FAST_ALLOC) {
         page = page_new();
-    } else {
-        splock_unlock(&vmsp->lock);
+    } else if ((page = page_zero_take()) == 0) {
+        vmsp_rdunlock(vmsp);
         page = page_new();
-        void *ptr = kmap(PAGE_SIZE, NULL, page, VMA_PHYS | VM_RW);
+        if (page != 0) {
+            void *ptr = kmap_atomic(page, VM_RW);
+#ifdef KORA_KRN
+            memset(ptr, 0, PAGE_SIZE);
+#endif
+            kunmap_atomic(ptr);
+        }
+        vmsp_rdlock(vmsp);
+    }
+    return page;
+}
+
+/* Take a run of blank pages at once, unless some might be on the swap */
+size_t vma_fetch_run_blank(vmsp_t *vmsp, vma_t *vma, int count)
+{
+    if (vmsp->w_size != 0)
+        return 0;
+    size_t page = page_get(PGZ_ANY, count);
+    if (page == 0 || (vma->flags & VM_FAST_ALLOC))
+        return page;
+    vmsp_rdunlock(vmsp);
+    for (int i = 0; i < count; ++i) {
+        void *ptr = kmap_atomic(page + i * PAGE_SIZE, VM_RW);
 #ifdef KORA_KRN
         memset(ptr, 0, PAGE_SIZE);
 #endif
-        kunmap(ptr, PAGE_SIZE);
-        splock_lock(&vmsp->lock);
+        kunmap_atomic(ptr);
     }
+    vmsp_rdlock(vmsp);
     return page;
 }
 
@@ -33,44 +76,111 @@ void vma_release_blank(vmsp_t *vmsp, vma_t *vma, xoff_t offset, size_t page)
 
 void vma_resolve_blank(vmsp_t *vmsp, vma_t *vma, size_t vaddr, size_t page)
 {
+    if (vmsp->w_size != 0) {
+        long slot = swap_detach(vmsp, vaddr);
+        if (slot != 0)
+            swap_free(slot);
+    }
     vmsp->p_size++;
     int t = mmu_resolve(vaddr, page, vma->flags & VM_RW);
     vmsp->t_size += t;
 }
 
-void vma_unmap_blank(vmsp_t *vmsp, vma_t *vma, size_t address)
+void vma_unmap_blank(vmsp_t *vmsp, vma_t *vma, size_t address, size_t pg)
 {
-
-    size_t pg = mmu_drop(address);
-    if (pg != 0) {
-        bool private = page_shared(vmsp->share, pg, 0);
+    pg &= ~(PAGE_SIZE - 1);
+    if (pg == 0 && vmsp->w_size != 0) {
+        long slot = swap_detach(vmsp, address);
+        if (slot != 0)
+            swap_free(slot);
+    } else if (pg != 0) {
+        bool private = page_shared(pg, 0);
         if (private) {
             vmsp->p_size--;
             page_release(pg);
         } else {
             vmsp->s_size--;
-            if (page_shared(vmsp->share, pg, -1))
+            if (page_shared(pg, -1))
                 page_release(pg);
         }
     }
 }
 
+/* Move a private page to the swap, it will be written by the shrinker */
+int vma_evict_blank(vmsp_t *vmsp, vma_t *vma, size_t vaddr)
+{
+    size_t page = mmu_read(vaddr);
+    if (page == 0 || !page_shared(page, 0))
+        return -1;
+    long slot = swap_out(page);
+    if (slot == 0)
+        return -1;
+    mmu_drop(vaddr);
+    vmsp->p_size--;
+    swap_attach(vmsp, vaddr, slot);
+    return 0;
+}
+
+/* Back a whole aligned huge page at once, if the VMA covers it */
+int vma_huge_anon(vmsp_t *vmsp, vma_t *vma, size_t vaddr)
+{
+    size_t base = ALIGN_DW(vaddr, HUGE_PAGE_SIZE);
+    if (vmsp == __mmu.kspace || base < vma->node.value_ || base + HUGE_PAGE_SIZE > vma->node.value_ + vma->length)
+        return -1;
+    if (vmsp->w_size != 0)
+        return -1;
+    if (!mmu_huge_usable(base))
+        return -1;
+
+    size_t seq = vmsp->seq;
+    vmsp_rdunlock(vmsp);
+    size_t page = page_get(PGZ_ANY, HUGE_PAGE_PAGES);
+    if (page != 0) {
+        void *ptr = kmap(HUGE_PAGE_SIZE, NULL, page, VMA_PHYS | VM_RW);
+#ifdef KORA_KRN
+        memset(ptr, 0, HUGE_PAGE_SIZE);
+#endif
+        kunmap(ptr, HUGE_PAGE_SIZE);
+    }
+    vmsp_rdlock(vmsp);
+    if (page == 0)
+        return -1;
+
+    // The range might have been changed while unlocked
+    splock_lock(&vmsp->plock);
+    if (vmsp->seq != seq || !mmu_huge_usable(base)) {
+        splock_unlock(&vmsp->plock);
+        for (int i = 0; i < HUGE_PAGE_PAGES; ++i)
+            page_release(page + i * PAGE_SIZE);
+        return -1;
+    }
+
+    mmu_resolve_huge(base, page, vma->flags & VM_RW);
+    vmsp->p_size += HUGE_PAGE_PAGES;
+    vmsp->h_size++;
+    splock_unlock(&vmsp->plock);
+    return 0;
+}
+
 int vma_protect_anon(vmsp_t *vmsp, vma_t *vma, int flags)
 {
     size_t length = vma->length;
     size_t address = vma->node.value_;
     vma->flags = (vma->flags & ~VM_RWX) | (flags & VM_RWX);
+    // Without write access, shared and private pages get the same rights,
+    // otherwise shared ones, like the zero page, are kept read-only
+    if (!(flags & VM_WR)) {
+        mmu_protect_range(address, length, flags & VM_RWX);
+        return 0;
+    }
     while (length) {
         size_t pg = mmu_read(address);
         if (pg != 0) {
-            if (vma->flags & VMA_COW) {
-                bool private = page_shared(vmsp->share, pg, 0);
-                if (private)
-                    mmu_protect(address, flags & VM_RWX);
-                else
-                    mmu_protect(address, flags & VM_RX);
-            } else
+            bool private = page_shared(pg, 0);
+            if (private)
                 mmu_protect(address, flags & VM_RWX);
+            else
+                mmu_protect(address, flags & VM_RX);
         }
         length -= PAGE_SIZE;
         address += PAGE_SIZE;
@@ -91,12 +201,15 @@ char *vma_print_anon(vma_t *vma, char *buf, size_t len)
 
 vma_ops_t vma_ops_anon = {
     .fetch = vma_fetch_blank,
+    .fetch_run = vma_fetch_run_blank,
     .release = vma_release_blank,
     .resolve = vma_resolve_blank,
     .unmap = vma_unmap_blank,
     .protect = vma_protect_anon,
     .split = vma_split_anon,
     .print = vma_print_anon,
+    .huge = vma_huge_anon,
+    .evict = vma_evict_blank,
 };
 
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
@@ -116,18 +229,22 @@ char *vma_print_heap(vma_t *vma, char *buf, size_t len)
 
 vma_ops_t vma_ops_stack = {
     .fetch = vma_fetch_blank,
+    .fetch_run = vma_fetch_run_blank,
     .release = vma_release_blank,
     .resolve = vma_resolve_blank,
     .unmap = vma_unmap_blank,
     .print = vma_print_stack,
+    .evict = vma_evict_blank,
 
 };
 
 vma_ops_t vma_ops_heap = {
     .fetch = vma_fetch_blank,
+    .fetch_run = vma_fetch_run_blank,
     .release = vma_release_blank,
     .resolve = vma_resolve_blank,
     .unmap = vma_unmap_blank,
     .print = vma_print_heap,
+    .evict = vma_evict_blank,
 };
 
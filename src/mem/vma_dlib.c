@@ -12,9 +12,9 @@ size_t vma_fetch_dlib(vmsp_t *vmsp, vma_t *vma, xoff_t offset, bool blocking)
 {
     if (!blocking)
         return dlib_fetch_page(vma->lib, offset, false);
-    splock_unlock(&vmsp->lock);
+    vmsp_rdunlock(vmsp);
     size_t page = dlib_fetch_page(vma->lib, offset, true);
-    splock_lock(&vmsp->lock);
+    vmsp_rdlock(vmsp);
     return page;
 }
 
@@ -38,14 +38,14 @@ int vma_shared_dlib(vmsp_t *vmsp, vma_t *vma, size_t address, size_t page)
         dlib_release_page(vma->lib, offset, old);
     if (old != 0 && old == page)
         return VPG_BACKEDUP; // This is a backedup page
-    if (!page_shared(vmsp->share, page, 0))
+    if (!page_shared(page, 0))
         return VPG_SHARED; // This is a shared page
     return VPG_PRIVATE; // This is a private page
 }
 
-void vma_unmap_dlib(vmsp_t *vmsp, vma_t *vma, size_t address)
+void vma_unmap_dlib(vmsp_t *vmsp, vma_t *vma, size_t address, size_t pg)
 {
-    size_t pg = mmu_drop(address);
+    pg &= ~(PAGE_SIZE - 1);
     if (pg != 0) {
         int status = vma_shared_dlib(vmsp, vma, address, pg);
         if (status == VPG_PRIVATE) {
@@ -53,7 +53,7 @@ void vma_unmap_dlib(vmsp_t *vmsp, vma_t *vma, size_t address)
             page_release(pg);
         } else if (status == VPG_SHARED) {
             vmsp->s_size--;
-            if (page_shared(vmsp->share, pg, -1))
+            if (page_shared(pg, -1))
                 page_release(pg);
         } else {
             xoff_t offset = vma->offset + (xoff_t)(address - vma->node.value_);
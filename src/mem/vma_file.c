@@ -23,15 +23,15 @@ int vma_shared_filecpy(vmsp_t *vmsp, vma_t *vma, size_t address, size_t page)
         vfs_release_page(vma->ino, offset, old, false);
     if (old != 0 && old == page)
         return VPG_BACKEDUP; // This is a backedup page
-    if (!page_shared(vmsp->share, page, 0))
+    if (!page_shared(page, 0))
         return VPG_SHARED; // This is a shared page
     return VPG_PRIVATE; // This is a private page
 }
 
-void vma_unmap_filecpy(vmsp_t *vmsp, vma_t *vma, size_t address)
+void vma_unmap_filecpy(vmsp_t *vmsp, vma_t *vma, size_t address, size_t pg)
 {
-    bool dirty = mmu_dirty(address);
-    size_t pg = mmu_drop(address);
+    bool dirty = pg & MMU_DIRTY;
+    pg &= ~(PAGE_SIZE - 1);
     if (pg != 0) {
         int status = vma_shared_filecpy(vmsp, vma, address, pg);
         if (status == VPG_PRIVATE) {
@@ -39,7 +39,7 @@ void vma_unmap_filecpy(vmsp_t *vmsp, vma_t *vma, size_t address)
             page_release(pg);
         } else if (status == VPG_SHARED) {
             vmsp->s_size--;
-            if (page_shared(vmsp->share, pg, -1))
+            if (page_shared(pg, -1))
                 page_release(pg);
         } else {
             xoff_t offset = vma->offset + (xoff_t)(address - vma->node.value_);
@@ -55,6 +55,10 @@ int vma_protect_filecpy(vmsp_t *vmsp, vma_t *vma, int flags)
     size_t length = vma->length;
     size_t address = vma->node.value_;
     vma->flags = (vma->flags & ~VM_RWX) | (flags & VM_RW);
+    if (!(flags & VM_WR)) {
+        mmu_protect_range(address, length, flags & VM_RWX);
+        return 0;
+    }
     while (length) {
         size_t pg = mmu_read(address);
         if (pg != 0) {
@@ -76,9 +80,9 @@ size_t vma_fetch_file(vmsp_t *vmsp, vma_t *vma, xoff_t offset, bool blocking)
 {
     if (!blocking)
         return vfs_fetch_page(vma->ino, offset, false);
-    splock_unlock(&vmsp->lock);
+    vmsp_rdunlock(vmsp);
     size_t page = vfs_fetch_page(vma->ino, offset, true);
-    splock_lock(&vmsp->lock);
+    vmsp_rdlock(vmsp);
     return page;
 }
 
@@ -94,10 +98,10 @@ void vma_resolve_file(vmsp_t *vmsp, vma_t *vma, size_t vaddr, size_t page)
     vmsp->t_size += t;
 }
 
-void vma_unmap_file(vmsp_t *vmsp, vma_t *vma, size_t address)
+void vma_unmap_file(vmsp_t *vmsp, vma_t *vma, size_t address, size_t pg)
 {
-    bool dirty = mmu_dirty(address);
-    size_t pg = mmu_drop(address);
+    bool dirty = pg & MMU_DIRTY;
+    pg &= ~(PAGE_SIZE - 1);
     if (pg != 0) {
         xoff_t offset = vma->offset + (xoff_t)(address - vma->node.value_);
         vfs_release_page(vma->ino, offset, pg, dirty);
@@ -111,13 +115,7 @@ int vma_protect_file(vmsp_t *vmsp, vma_t *vma, int flags)
     size_t length = vma->length;
     size_t address = vma->node.value_;
     vma->flags = (vma->flags & ~VM_RWX) | (flags & VM_RW);
-    while (length) {
-        size_t pg = mmu_read(address);
-        if (pg != 0)
-            mmu_protect(address, flags & VM_RWX);
-        length -= PAGE_SIZE;
-        address += PAGE_SIZE;
-    }
+    mmu_protect_range(address, length, flags & VM_RWX);
     return 0;
 }
 
@@ -9,9 +9,10 @@
 
 
 size_t vma_fetch_blank(vmsp_t *vmsp, vma_t *vma, xoff_t offset, bool blocking);
+size_t vma_fetch_run_blank(vmsp_t *vmsp, vma_t *vma, int count);
 void vma_release_blank(vmsp_t *vmsp, vma_t *vma, xoff_t offset, size_t page);
 void vma_resolve_blank(vmsp_t *vmsp, vma_t *vma, size_t vaddr, size_t page);
-void vma_unmap_blank(vmsp_t *vmsp, vma_t *vma, size_t address);
+void vma_unmap_blank(vmsp_t *vmsp, vma_t *vma, size_t address, size_t page);
 
 
 char *vma_print_pipe(vma_t *vma, char *buf, size_t len)
@@ -22,6 +23,7 @@ char *vma_print_pipe(vma_t *vma, char *buf, size_t len)
 
 vma_ops_t vma_ops_pipe = {
     .fetch = vma_fetch_blank,
+    .fetch_run = vma_fetch_run_blank,
     .release = vma_release_blank,
     .resolve = vma_resolve_blank,
     .unmap = vma_unmap_blank,
@@ -41,9 +43,8 @@ void vma_resolve_phys(vmsp_t *vmsp, vma_t *vma, size_t vaddr, size_t page)
     vmsp->t_size += t;
 }
 
-void vma_unmap_phys(vmsp_t *vmsp, vma_t *vma, size_t address)
+void vma_unmap_phys(vmsp_t *vmsp, vma_t *vma, size_t address, size_t page)
 {
-    mmu_drop(address);
 }
 
 int vma_protect_phys(vmsp_t *vmsp, vma_t *vma, int flags)
@@ -51,11 +52,7 @@ int vma_protect_phys(vmsp_t *vmsp, vma_t *vma, int flags)
     size_t length = vma->length;
     size_t address = vma->node.value_;
     vma->flags = flags & (VM_RW | VM_UNCACHABLE);
-    while (length) {
-        mmu_protect(address, vma->flags & (VM_UNCACHABLE | VM_RW));
-        length -= PAGE_SIZE;
-        address += PAGE_SIZE;
-    }
+    mmu_protect_range(address, length, vma->flags & (VM_UNCACHABLE | VM_RW));
     return 0;
 }
 
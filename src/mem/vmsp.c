@@ -3,6 +3,7 @@
 #include <kora/splock.h>
 #include <kernel/memory.h>
 #include <kernel/dlib.h>
+#include <kernel/slab.h>
 #include <bits/atomic.h>
 #include <errno.h>
 #include <assert.h>
@@ -22,10 +23,64 @@ extern vma_ops_t vma_ops_filecpy;
 extern vma_ops_t vma_ops_file;
 extern vma_ops_t vma_ops_dlib;
 
+static kmem_cache_t vma_cache = INIT_KMEM_CACHE("vma", vma_t, NULL);
+
+/* The kernel space is changed by kmap from any context, so its lock spins
+ * with interrupts disabled. User spaces are only locked by tasks, which
+ * sleep on it and keep interrupts enabled while they fault. */
+void vmsp_rdlock(vmsp_t *vmsp)
+{
+    if (vmsp == __mmu.kspace)
+        rwlock_rdlock(&vmsp->klock);
+    else
+        rwsem_rdlock(&vmsp->lock);
+}
+
+void vmsp_rdunlock(vmsp_t *vmsp)
+{
+    if (vmsp == __mmu.kspace)
+        rwlock_rdunlock(&vmsp->klock);
+    else
+        rwsem_rdunlock(&vmsp->lock);
+}
+
+void vmsp_lock(vmsp_t *vmsp)
+{
+    if (vmsp == __mmu.kspace)
+        rwlock_wrlock(&vmsp->klock);
+    else
+        rwsem_wrlock(&vmsp->lock);
+    vmsp->seq++;
+}
+
+void vmsp_unlock(vmsp_t *vmsp)
+{
+    if (vmsp == __mmu.kspace)
+        rwlock_wrunlock(&vmsp->klock);
+    else
+        rwsem_wrunlock(&vmsp->lock);
+}
+
+bool vmsp_locked(vmsp_t *vmsp)
+{
+    if (vmsp == __mmu.kspace)
+        return rwlock_wrlocked(&vmsp->klock);
+    return rwsem_wrlocked(&vmsp->lock);
+}
+
+/* Areas of the kernel space stay on the heap, as the slabs of the cache
+ * are themselves mapped on the kernel space */
+static vma_t *vma_alloc(vmsp_t *vmsp)
+{
+    vma_t *vma = vmsp == __mmu.kspace ? kzalloc(sizeof(vma_t)) : kmem_cache_alloc(&vma_cache);
+    vma->space = vmsp;
+    return vma;
+}
+
 static vma_t *vma_create(vmsp_t *vmsp, size_t address, size_t length, void *ptr, xoff_t offset, int flags)
 {
-    assert(splock_locked(&vmsp->lock));
-    vma_t *vma = kalloc(sizeof(vma_t));
+    assert(vmsp_locked(vmsp));
+    vma_t *vma = vma_alloc(vmsp);
     vma->node.value_ = address;
     vma->length = length;
     vma->usage = 1;
@@ -60,7 +115,6 @@ static vma_t *vma_create(vmsp_t *vmsp, size_t address, size_t length, void *ptr,
         break;
     case VMA_PHYS:
         assert(vmsp == __mmu.kspace);
-        flags |= VM_RESOLVE;
         vma->flags = (flags & (VM_RW | VM_UNCACHABLE));
         vma->offset = offset;
         vma->ops = &vma_ops_phys;
@@ -93,81 +147,144 @@ static vma_t *vma_create(vmsp_t *vmsp, size_t address, size_t length, void *ptr,
 
     bbtree_insert(&vmsp->tree, &vma->node);
     vmsp->v_size += length / PAGE_SIZE;
+    vmsp->areas++;
     // kprintf(KL_VMA, "On %s%p, add vma %s\n", VMS_NAME(vmsp), vmsp, vma->ops->print(vma, tmp, 32));
+    return vma;
+}
 
-    if (flags & VM_RESOLVE) {
-        while (length > 0) {
-            int ret = vma_resolve(vmsp, vma, address, true, false);
-            if (ret != 0) {
-                // TODO -- Cancel and unmap !?
-                break;
-            }
-            address += PAGE_SIZE;
-            length -= PAGE_SIZE;
+
+/* Map the pages already cached around a read fault on a backed area, areas
+ * accessed sequentially read the next pages instead */
+static void vma_fault_around(vmsp_t *vmsp, vma_t *vma, size_t vaddr)
+{
+    size_t seq = vmsp->seq;
+    size_t window = VMA_AROUND_PAGES * PAGE_SIZE;
+    size_t address = MAX(ALIGN_DW(vaddr, window), vma->node.value_);
+    size_t limit = MIN(ALIGN_DW(vaddr, window) + window, vma->node.value_ + vma->length);
+    bool ahead = vma->flags & VMA_SEQUENTIAL;
+    if (ahead) {
+        address = vaddr + PAGE_SIZE;
+        limit = MIN(vaddr + VMA_AHEAD_PAGES * PAGE_SIZE, vma->node.value_ + vma->length);
+    }
+    for (; address < limit; address += PAGE_SIZE) {
+        if (address == vaddr || mmu_read(address) != 0)
+            continue;
+        xoff_t offset = vma->offset + (xoff_t)(address - vma->node.value_);
+        size_t page = vma->ops->fetch(vmsp, vma, offset, false);
+        if (page == 0 && ahead)
+            page = vma->ops->fetch(vmsp, vma, offset, true);
+        if (page == 0 || page == (size_t)-1)
+            continue;
+        // The space might have been released to read the page
+        splock_lock(&vmsp->plock);
+        if (vmsp->seq == seq && mmu_read(address) == 0) {
+            vma->ops->resolve(vmsp, vma, address, page);
+            __mmu.fault_around++;
+            page = 0;
         }
+        splock_unlock(&vmsp->plock);
+        if (page != 0)
+            vma->ops->release(vmsp, vma, offset, page);
+        if (vmsp->seq != seq)
+            break;
     }
-
-    return vma;
 }
 
+/* Untouched pages of user blank areas are read from the zero page */
+static bool vma_reads_zero(vmsp_t *vmsp, vma_t *vma)
+{
+    if (vmsp == __mmu.kspace || __mmu.zero_page == 0)
+        return false;
+    return vma->ops == &vma_ops_anon || vma->ops == &vma_ops_heap;
+}
 
+/* Resolve a fault while holding the space shared and a reference on the
+ * VMA. Operations might release the space to sleep, in which case the fault
+ * returns a positive value to be retried if the layout changed meanwhile. */
 int vma_resolve(vmsp_t *vmsp, vma_t *vma, size_t vaddr, bool missing, bool write)
 {
-    // We should check vmsp is locked, but irq_semaphore == 1 !
-
+    size_t seq = vmsp->seq;
     xoff_t offset = vma->offset + (xoff_t)(vaddr - vma->node.value_);
+    if (missing && !write && vma_reads_zero(vmsp, vma)) {
+        // Pages on the swap must be read back
+        splock_lock(&vmsp->plock);
+        bool swapped = vmsp->w_size != 0 && swap_lookup(vmsp, vaddr) != 0;
+        if (!swapped && mmu_read(vaddr) == 0) {
+            page_shared(__mmu.zero_page, 1);
+            vmsp->s_size++;
+            vmsp->t_size += mmu_resolve(vaddr, __mmu.zero_page, vma->flags & VM_RX);
+        }
+        splock_unlock(&vmsp->plock);
+        if (!swapped)
+            return 0;
+    }
+
+    if (missing && vma->ops->huge && vma->ops->huge(vmsp, vma, vaddr) == 0)
+        return 0;
+
     if (missing) {
         // Look for page
         size_t page = vma->ops->fetch(vmsp, vma, offset, false);
-        if (page == 0) {
+        if (page == 0)
             page = vma->ops->fetch(vmsp, vma, offset, true);
-
-            if (unlikely(vma->flags & VM_UNMAPED)) {
-                vma->ops->release(vmsp, vma, offset, page);
-                vma_unmap(vmsp, vma);
-                kprintf(KL_PF, PF_ERR"Mapping removed at this address '%p'\n", (void *)vaddr);
-                return -1;
-            }
-
-            if (page == 0) {
-                kprintf(KL_PF, PF_ERR"Mapping can't retrieve the page at '%p'\n", (void *)vaddr);
-                return -1;
-            }
+        if (page == 0) {
+            if (vmsp->seq != seq)
+                return 1;
+            kprintf(KL_PF, PF_ERR"Mapping can't retrieve the page at '%p'\n", (void *)vaddr);
+            return -1;
         }
 
-        // Resolve the page
-        vma->ops->resolve(vmsp, vma, vaddr, page);
+        // Resolve the page, unless a concurrent fault already did
+        splock_lock(&vmsp->plock);
+        bool retry = vmsp->seq != seq;
+        bool mapped = !retry && mmu_read(vaddr) == 0;
+        if (mapped)
+            vma->ops->resolve(vmsp, vma, vaddr, page);
+        splock_unlock(&vmsp->plock);
+        if (!mapped)
+            vma->ops->release(vmsp, vma, offset, page);
+        if (retry)
+            return 1;
+        if (mapped && !write && (vma->flags & VMA_BACKEDUP) && !(vma->flags & VMA_RANDOM))
+            vma_fault_around(vmsp, vma, vaddr);
     }
 
-    if ((!missing || (vma->flags & VMA_BACKEDUP)) && write && (vma->flags & VMA_COW)) {
+    // Writes on the zero page take the same path as copy-on-write
+    bool zero = !missing && __mmu.zero_page != 0 && mmu_read(vaddr) == __mmu.zero_page;
+    if ((!missing || (vma->flags & VMA_BACKEDUP)) && write && ((vma->flags & VMA_COW) || zero)) {
         assert(vma->flags & VM_WR);
 
-        // Copy the page
-        splock_unlock(&vmsp->lock);
-        size_t page = page_new();
-        void *ptr = kmap(PAGE_SIZE, NULL, page, VMA_PHYS | VM_RW);
+        // Copy the page, the layout can't change while the space is shared
+        size_t old = mmu_read(vaddr);
+        size_t page = zero ? page_zero_take() : 0;
+        if (page == 0) {
+            page = page_new();
+            if (page == 0)
+                return -1;
+            void *ptr = kmap_atomic(page, VM_RW);
 #ifdef KORA_KRN
-        memcpy(ptr, (void *)vaddr, PAGE_SIZE);
+            memcpy(ptr, (void *)vaddr, PAGE_SIZE);
 #endif
-        kunmap(ptr, PAGE_SIZE);
-        splock_lock(&vmsp->lock);
+            kunmap_atomic(ptr);
+        }
 
-        if (vma->flags & VM_UNMAPED) {
-            vma->ops->release(vmsp, vma, offset, page);
-            vma_unmap(vmsp, vma);
-            kprintf(KL_PF, PF_ERR"Mapping removed at this address '%p'\n", (void *)vaddr);
-            return -1;
+        splock_lock(&vmsp->plock);
+        if (mmu_read(vaddr) != old || (mmu_read_flags(vaddr) & VM_WR)) {
+            // A concurrent fault made its own copy
+            splock_unlock(&vmsp->plock);
+            page_release(page);
+            return 0;
         }
 
         // Release previous one
-        size_t old = mmu_read(vaddr);
         int status = VPG_SHARED;
         if (vma->flags & VMA_BACKEDUP)
             status = vma->ops->shared(vmsp, vma, vaddr, old);
         if (status == VPG_BACKEDUP)
             vma->ops->release(vmsp, vma, offset, old);
         else {
-            if (page_shared(vmsp->share, old, -1))
+            merge_broken(old);
+            if (page_shared(old, -1))
                 page_release(old);
         }
 
@@ -175,46 +292,195 @@ int vma_resolve(vmsp_t *vmsp, vma_t *vma, size_t vaddr, bool missing, bool write
         vmsp->s_size--;
         vmsp->p_size++;
         mmu_resolve(vaddr, page, VM_RW);
+        splock_unlock(&vmsp->plock);
     }
 
     return 0;
 }
 
+/* Drop a reference on a VMA, the last one closes it */
+static void vma_put(vma_t *vma)
+{
+    if (atomic_xadd(&vma->usage, -1) != 1)
+        return;
+    if (vma->ops->close)
+        vma->ops->close(vma);
+    // Close
+    if (vma->space == __mmu.kspace)
+        kfree(vma);
+    else
+        kmem_cache_free(&vma_cache, vma);
+}
+
+/* Pages shared by a clone are recorded on the new space by ranges, and
+ * only mapped on the first fault inside their range. A space replaced by a
+ * new image right away releases them without touching its page tables. */
+typedef struct vmsp_deferred vmsp_deferred_t;
+
+struct vmsp_deferred
+{
+    bbnode_t node;  /* Base address of the range */
+    int count;
+    size_t pages[VMSP_DEFERRED_PAGES];
+};
+
+#define VMSP_DEFERRED_SPAN  (VMSP_DEFERRED_PAGES * PAGE_SIZE)
+
+/* Record a page shared by a clone, `range' caches the last range used */
+static void vmsp_defer(vmsp_t *vmsp, vmsp_deferred_t **range, size_t address, size_t page)
+{
+    size_t base = ALIGN_DW(address, VMSP_DEFERRED_SPAN);
+    if (*range == NULL || (*range)->node.value_ != base) {
+        *range = bbtree_search_eq(&vmsp->deferred, base, vmsp_deferred_t, node);
+        if (*range == NULL) {
+            *range = kzalloc(sizeof(vmsp_deferred_t));
+            (*range)->node.value_ = base;
+            bbtree_insert(&vmsp->deferred, &(*range)->node);
+        }
+    }
+    (*range)->pages[(address - base) / PAGE_SIZE] = page;
+    (*range)->count++;
+    vmsp->d_size++;
+}
+
+static vmsp_deferred_t *vmsp_deferred_at(vmsp_t *vmsp, size_t address)
+{
+    vmsp_deferred_t *range = bbtree_search_le(&vmsp->deferred, address, vmsp_deferred_t, node);
+    if (range == NULL)
+        range = bbtree_first(&vmsp->deferred, vmsp_deferred_t, node);
+    return range;
+}
+
+/* Map the recorded pages of the ranges overlapping a part of the space,
+ * the space must be current */
+static void vmsp_install(vmsp_t *vmsp, size_t base, size_t length)
+{
+    if (vmsp->d_size == 0)
+        return;
+    splock_lock(&vmsp->plock);
+    vmsp_deferred_t *range = vmsp_deferred_at(vmsp, base);
+    while (range != NULL && range->node.value_ < base + length) {
+        vmsp_deferred_t *next = bbtree_next(&range->node, vmsp_deferred_t, node);
+        size_t address = range->node.value_;
+        if (address + VMSP_DEFERRED_SPAN <= base) {
+            range = next;
+            continue;
+        }
+
+        vma_t *vma = NULL;
+        for (int i = 0; i < VMSP_DEFERRED_PAGES; ++i, address += PAGE_SIZE) {
+            if (range->pages[i] == 0)
+                continue;
+            if (vma == NULL || address >= vma->node.value_ + vma->length)
+                vma = vmsp_find_area(vmsp, address);
+            assert(vma != NULL);
+            vmsp->t_size += mmu_resolve(address, range->pages[i], vma->flags & VM_RX);
+        }
+        vmsp->d_size -= range->count;
+        bbtree_remove(&vmsp->deferred, range->node.value_);
+        kfree(range);
+        range = next;
+    }
+    splock_unlock(&vmsp->plock);
+}
+
+/* Release the recorded pages of a part of an area, which were never mapped */
+static void vma_drop_deferred(vmsp_t *vmsp, vma_t *vma, size_t address, size_t length)
+{
+    size_t limit = address + length;
+    vmsp_deferred_t *range = vmsp_deferred_at(vmsp, address);
+    while (range != NULL && range->node.value_ < limit) {
+        vmsp_deferred_t *next = bbtree_next(&range->node, vmsp_deferred_t, node);
+        size_t base = range->node.value_;
+        size_t start = MAX(base, address);
+        size_t end = MIN(base + VMSP_DEFERRED_SPAN, limit);
+        for (; start < end; start += PAGE_SIZE) {
+            int i = (start - base) / PAGE_SIZE;
+            if (range->pages[i] == 0)
+                continue;
+            vma->ops->unmap(vmsp, vma, start, range->pages[i]);
+            range->pages[i] = 0;
+            range->count--;
+            vmsp->d_size--;
+        }
+        if (range->count == 0) {
+            bbtree_remove(&vmsp->deferred, base);
+            kfree(range);
+        }
+        range = next;
+    }
+}
+
+/* Clear a dropped page before it goes back to the allocator, unless some
+ * other mapping still uses it */
+static void vma_clean_page(size_t page)
+{
+    page &= ~(PAGE_SIZE - 1);
+    if (page == 0 || page == __mmu.zero_page || page_frame(page) == NULL || !page_shared(page, 0))
+        return;
+#ifdef KORA_KRN
+    void *ptr = kmap_atomic(page, VM_RW);
+    memset(ptr, 0, PAGE_SIZE);
+    kunmap_atomic(ptr);
+#endif
+}
+
+/* Release all the pages mapped on a part of an area */
+static void vma_drop_pages(vmsp_t *vmsp, vma_t *vma, size_t address, size_t length)
+{
+    size_t pages[VMA_UNMAP_BATCH];
+    assert(vmsp_locked(vmsp));
+    if (vmsp->d_size != 0)
+        vma_drop_deferred(vmsp, vma, address, length);
+    while (length > 0) {
+        // Whole huge pages are dropped at once, batches stop at their bounds
+        size_t huge = ALIGN_DW(address, HUGE_PAGE_SIZE) + HUGE_PAGE_SIZE;
+        if (vmsp->h_size != 0 && huge - address == HUGE_PAGE_SIZE && length >= HUGE_PAGE_SIZE) {
+            size_t page = mmu_drop_huge(address);
+            if (page != 0) {
+                for (size_t i = 0; i < HUGE_PAGE_PAGES; ++i) {
+                    if (vma->flags & VMA_CLEAN)
+                        vma_clean_page(page + i * PAGE_SIZE);
+                    vma->ops->unmap(vmsp, vma, address + i * PAGE_SIZE, page + i * PAGE_SIZE);
+                }
+                length -= HUGE_PAGE_SIZE;
+                address += HUGE_PAGE_SIZE;
+                continue;
+            }
+        }
+        size_t count = MIN(MIN(length, huge - address) / PAGE_SIZE, VMA_UNMAP_BATCH);
+        vmsp->t_size -= mmu_drop_range(address, count * PAGE_SIZE, pages);
+        for (size_t i = 0; i < count; ++i) {
+            if (vma->flags & VMA_CLEAN)
+                vma_clean_page(pages[i]);
+            vma->ops->unmap(vmsp, vma, address + i * PAGE_SIZE, pages[i]);
+        }
+        length -= count * PAGE_SIZE;
+        address += count * PAGE_SIZE;
+    }
+}
+
 void vma_unmap(vmsp_t *vmsp, vma_t *vma)
 {
     // char tmp[32];
-    assert(splock_locked(&vmsp->lock));
+    assert(vmsp_locked(vmsp));
     if ((vma->flags & VM_UNMAPED) == 0) {
         bbtree_remove(&vmsp->tree, vma->node.value_);
         // kprintf(KL_VMA, "On %s%p, close vma %s\n", VMS_NAME(vmsp), vmsp, vma->ops->print(vma, tmp, 32));
         // Unmap pages
         vmsp->v_size -= vma->length / PAGE_SIZE;
-        size_t length = vma->length;
-        size_t address = vma->node.value_;
-        while (length > 0) {
-#if _KORA_KRN
-            if (vma->flags & VMA_CLEAN && mmu_read(address) != 0)
-                memset((void *)address, 0, PAGE_SIZE);
-#endif
-            vma->ops->unmap(vmsp, vma, address);
-            length -= PAGE_SIZE;
-            address += PAGE_SIZE;
-        }
-        
+        vmsp->areas--;
+        vma_drop_pages(vmsp, vma, vma->node.value_, vma->length);
+
         vma->flags |= VM_UNMAPED;
     }
-    if (atomic_xadd(&vma->usage, -1) != 1)
-        return;
-    if (vma->ops->close)
-        vma->ops->close(vma);
-    // Close
-    kfree(vma);
+    vma_put(vma);
 }
 
 vma_t *vma_clone(vmsp_t *vmsp1, vmsp_t *vmsp2, vma_t *vma)
 {
     // char tmp[32];
-    vma_t *cpy = kalloc(sizeof(vma_t));
+    vma_t *cpy = vma_alloc(vmsp1);
     cpy->node.value_ = vma->node.value_;
     cpy->length = vma->length;
     cpy->usage = 1;
@@ -224,6 +490,7 @@ vma_t *vma_clone(vmsp_t *vmsp1, vmsp_t *vmsp2, vma_t *vma)
         vma->ops->clone(vmsp1, vmsp2, cpy, vma);
    
     if (vma->flags & VMA_COW) {
+        vmsp_deferred_t *range = NULL;
         size_t length = vma->length;
         size_t address = vma->node.value_;
         while (length > 0) {
@@ -233,55 +500,150 @@ vma_t *vma_clone(vmsp_t *vmsp1, vmsp_t *vmsp2, vma_t *vma)
                 if (vma->flags & VMA_BACKEDUP)
                     status = vma->ops->shared(vmsp1, vma, address, page);
                 else {
-                    status = page_shared(vmsp1->share, page, 0) ? VPG_PRIVATE : VPG_SHARED;
+                    status = page_shared(page, 0) ? VPG_PRIVATE : VPG_SHARED;
                 }
 
                 if (status == VPG_PRIVATE) {
-                    mmu_set(vmsp1->directory, address, page, vma->flags & VM_RX);
+                    vmsp_defer(vmsp1, &range, address, page);
                     vmsp1->s_size++;
-                    mmu_protect(address, vma->flags & VM_RX);
                     vmsp2->s_size++;
                     vmsp2->p_size--;
-                    page_shared(vmsp1->share, page, 2);
+                    page_shared(page, 2);
                 } else if (status == VPG_SHARED) {
-                    mmu_set(vmsp1->directory, address, page, vma->flags & VM_RX);
+                    vmsp_defer(vmsp1, &range, address, page);
                     vmsp1->s_size++;
-                    page_shared(vmsp1->share, page, 1);
+                    page_shared(page, 1);
                 }
                 // Else nothing to do, need to fetch anyway...
+            } else if (vmsp2->w_size != 0) {
+                long slot = swap_lookup(vmsp2, address);
+                if (slot != 0) {
+                    swap_dup(slot);
+                    swap_attach(vmsp1, address, slot);
+                }
             }
             length -= PAGE_SIZE;
             address += PAGE_SIZE;
         }
+        // All pages still mapped are now shared, protect them in one pass.
+        // Only the mappings of the clone wait for its faults, the source
+        // shares its pages right away and can't be deferred.
+        mmu_protect_range(vma->node.value_, vma->length, vma->flags & VM_RX);
     }
 
     bbtree_insert(&vmsp1->tree, &cpy->node);
     vmsp1->v_size += vma->length / PAGE_SIZE;
+    vmsp1->areas++;
     // kprintf(KL_VMA, "On %s%p, clone vma %s from\n", VMS_NAME(vmsp1), vmsp1, cpy->ops->print(cpy, tmp, 32));
     return vma;
 }
 
+/* Two neighbours can be merged if the second one extends the first one */
+static bool vma_mergeable(vma_t *va1, vma_t *va2)
+{
+    if (va1->node.value_ + va1->length != va2->node.value_)
+        return false;
+    if (va1->ops != va2->ops || va1->ops->split == NULL || va1->flags != va2->flags)
+        return false;
+    if (va1->lib != va2->lib)
+        return false;
+    // Backed areas must continue on the same object
+    return va1->lib == NULL || va2->offset == va1->offset + (xoff_t)va1->length;
+}
+
+/* Absorb the next VMA, pages stay mapped */
+static void vma_merge(vmsp_t *vmsp, vma_t *vma, vma_t *next)
+{
+    assert(vmsp_locked(vmsp));
+    bbtree_remove(&vmsp->tree, next->node.value_);
+    vma->length += next->length;
+    bbtree_update(&vmsp->tree, &vma->node);
+    vmsp->areas--;
+    next->flags |= VM_UNMAPED;
+    vma_put(next);
+}
+
+/* Merge the compatible VMAs around and inside a range that just changed */
+static void vmsp_merge_range(vmsp_t *vmsp, size_t base, size_t length)
+{
+    size_t limit = base + length;
+    vma_t *vma = base > vmsp->lower_bound ? vmsp_find_area(vmsp, base - 1) : NULL;
+    if (vma == NULL)
+        vma = vmsp_find_area(vmsp, base);
+    while (vma != NULL) {
+        vma_t *next = bbtree_next(&vma->node, vma_t, node);
+        if (next == NULL || next->node.value_ > limit)
+            break;
+        if (vma_mergeable(vma, next))
+            vma_merge(vmsp, vma, next);
+        else
+            vma = next;
+    }
+}
+
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 
-static size_t vmsp_find_slot(vmsp_t *vmsp, size_t length)
+/* Summarize the address range and the largest hole of a subtree of VMAs */
+void vma_augment(bbnode_t *node, bbnode_t *left, bbnode_t *right)
 {
-    assert(splock_locked(&vmsp->lock));
-    vma_t *vma = bbtree_first(&vmsp->tree, vma_t, node);
-    if (vma == NULL || vmsp->lower_bound + length <= vma->node.value_)
-        return vmsp->lower_bound;
+    vma_t *vma = itemof(node, vma_t, node);
+    vma->lower = node->value_;
+    vma->upper = node->value_ + vma->length;
+    vma->max_gap = 0;
+    if (left != NULL) {
+        vma_t *lf = itemof(left, vma_t, node);
+        vma->lower = lf->lower;
+        vma->max_gap = MAX(lf->max_gap, node->value_ - lf->upper);
+    }
+    if (right != NULL) {
+        vma_t *rg = itemof(right, vma_t, node);
+        size_t gap = rg->lower - (node->value_ + vma->length);
+        vma->upper = rg->upper;
+        vma->max_gap = MAX(vma->max_gap, MAX(rg->max_gap, gap));
+    }
+}
 
-    for (;;) {
-        if (vma->node.value_ + vma->length + length > vmsp->upper_bound) {
-            errno = ENOMEM;
-            return 0;
-        }
+/* Lowest hole of `length' bytes above `floor' between the VMAs of a subtree */
+static size_t vma_find_gap(vma_t *vma, size_t floor, size_t length)
+{
+    if (vma == NULL || vma->max_gap < length || vma->upper < floor + length)
+        return 0;
 
-        vma_t *next = bbtree_next(&vma->node, vma_t, node);
-        if (next == NULL || vma->node.value_ + vma->length + length <= next->node.value_) {
-            return vma->node.value_ + vma->length;
-        }
-        vma = next;   
+    vma_t *left = bbtree_left_child(&vma->node, vma_t, node);
+    vma_t *right = bbtree_right_child(&vma->node, vma_t, node);
+    size_t base = vma_find_gap(left, floor, length);
+    if (base != 0)
+        return base;
+
+    if (left != NULL) {
+        base = MAX(left->upper, floor);
+        if (base + length <= vma->node.value_)
+            return base;
+    }
+    if (right != NULL) {
+        base = MAX(vma->node.value_ + vma->length, floor);
+        if (base + length <= right->lower)
+            return base;
+    }
+    return vma_find_gap(right, floor, length);
+}
+
+static size_t vmsp_find_slot(vmsp_t *vmsp, size_t floor, size_t length)
+{
+    assert(vmsp_locked(vmsp));
+    vma_t *root = bbtree_root(&vmsp->tree, vma_t, node);
+    size_t base = floor;
+    if (root != NULL && floor + length > root->lower) {
+        base = vma_find_gap(root, floor, length);
+        if (base == 0)
+            base = MAX(root->upper, floor);
+    }
+
+    if (base + length > vmsp->upper_bound) {
+        errno = ENOMEM;
+        return 0;
     }
+    return base;
 }
 
 static size_t vmsp_slot_address(vmsp_t *vmsp, size_t address, size_t length)
@@ -305,7 +667,6 @@ static size_t vmsp_slot_address(vmsp_t *vmsp, size_t address, size_t length)
 
 vma_t *vmsp_find_area(vmsp_t *vmsp, size_t address)
 {
-    assert(splock_locked(&vmsp->lock));
     if (address < vmsp->lower_bound || address >= vmsp->upper_bound)
         return NULL;
     vma_t *vma = bbtree_search_le(&vmsp->tree, address, vma_t, node);
@@ -314,6 +675,84 @@ vma_t *vmsp_find_area(vmsp_t *vmsp, size_t address)
     return vma;
 }
 
+/* Map a run of missing pages of an area, fetched first and mapped under a
+ * single page lock. Returns the length done, zero to retry if the space
+ * changed while released, or -1 on error */
+static long vma_populate(vmsp_t *vmsp, vma_t *vma, size_t address, size_t limit)
+{
+    size_t pages[VMA_POPULATE_BATCH];
+    size_t seq = vmsp->seq;
+    bool aligned = (address & (HUGE_PAGE_SIZE - 1)) == 0 && limit - address >= HUGE_PAGE_SIZE;
+    if (aligned && vma->ops->huge && vma->ops->huge(vmsp, vma, address) == 0)
+        return HUGE_PAGE_SIZE;
+
+    int count = 0;
+    while (count < VMA_POPULATE_BATCH && address + count * PAGE_SIZE < limit && mmu_read(address + count * PAGE_SIZE) == 0)
+        count++;
+    if (count == 0)
+        return PAGE_SIZE;
+
+    size_t run = count > 1 && vma->ops->fetch_run ? vma->ops->fetch_run(vmsp, vma, count) : 0;
+    for (int i = 0; i < count; ++i) {
+        xoff_t offset = vma->offset + (xoff_t)(address + i * PAGE_SIZE - vma->node.value_);
+        if (run != 0) {
+            pages[i] = run + i * PAGE_SIZE;
+            continue;
+        }
+        pages[i] = vma->ops->fetch(vmsp, vma, offset, false);
+        if (pages[i] == 0)
+            pages[i] = vma->ops->fetch(vmsp, vma, offset, true);
+        if (pages[i] == 0 || pages[i] == (size_t)-1) {
+            count = i;
+            break;
+        }
+    }
+
+    // Pages are mapped only if the layout didn't change meanwhile
+    splock_lock(&vmsp->plock);
+    bool mapped = vmsp->seq == seq;
+    for (int i = 0; mapped && i < count; ++i) {
+        if (mmu_read(address + i * PAGE_SIZE) == 0) {
+            vma->ops->resolve(vmsp, vma, address + i * PAGE_SIZE, pages[i]);
+            pages[i] = 0;
+        }
+    }
+    splock_unlock(&vmsp->plock);
+    for (int i = 0; i < count; ++i) {
+        xoff_t offset = vma->offset + (xoff_t)(address + i * PAGE_SIZE - vma->node.value_);
+        if (pages[i] != 0)
+            vma->ops->release(vmsp, vma, offset, pages[i]);
+    }
+    if (!mapped)
+        return 0;
+    return count > 0 ? count * PAGE_SIZE : -1;
+}
+
+/* Map all pages of a range ahead of any access, fails if pages are missing */
+static int vmsp_populate(vmsp_t *vmsp, size_t base, size_t length)
+{
+    int ret = 0;
+    vmsp_rdlock(vmsp);
+    vmsp_install(vmsp, base, length);
+    size_t address = base;
+    while (address < base + length) {
+        vma_t *vma = vmsp_find_area(vmsp, address);
+        if (vma == NULL)
+            break;
+        size_t limit = MIN(base + length, vma->node.value_ + vma->length);
+        atomic_inc(&vma->usage);
+        long len = vma_populate(vmsp, vma, address, limit);
+        vma_put(vma);
+        if (len < 0) {
+            ret = -1;
+            break;
+        }
+        address += len;
+    }
+    vmsp_rdunlock(vmsp);
+    return ret;
+}
+
 size_t vmsp_map(vmsp_t *vmsp, size_t address, size_t length, void *ptr, xoff_t offset, int flags)
 {
     // Check parameters
@@ -326,7 +765,7 @@ size_t vmsp_map(vmsp_t *vmsp, size_t address, size_t length, void *ptr, xoff_t o
     }
 
     // Look for a slot
-    splock_lock(&vmsp->lock);
+    vmsp_lock(vmsp);
 
     // If we have an address, check availability
     size_t base = 0;
@@ -334,37 +773,49 @@ size_t vmsp_map(vmsp_t *vmsp, size_t address, size_t length, void *ptr, xoff_t o
         base = vmsp_slot_address(vmsp, address, length);
         if (base == 0 && flags & VMA_FIXED) {
             errno = ERANGE;
-            splock_unlock(&vmsp->lock);
+            vmsp_unlock(vmsp);
             return 0;
         }
     }
 
-    // If we don't have address yet, look for a new spot
+    // If we don't have address yet, look for a new spot, above the hint first
+    if (base == 0 && address > vmsp->lower_bound && address < vmsp->upper_bound)
+        base = vmsp_find_slot(vmsp, ALIGN_DW(address, PAGE_SIZE), length);
     if (base == 0)
-        base = vmsp_find_slot(vmsp, length);
+        base = vmsp_find_slot(vmsp, vmsp->lower_bound, length);
 
     if (base == 0) {
         errno = ENOMEM;
-        splock_unlock(&vmsp->lock);
+        vmsp_unlock(vmsp);
         return 0;
     }
 
     // Create the VMA
     vma_t *vma = vma_create(vmsp, base, length, ptr, offset, flags);
     if (vma == NULL) {
-        splock_unlock(&vmsp->lock);
+        vmsp_unlock(vmsp);
         return 0;
     }
 
+    vmsp_merge_range(vmsp, base, length);
+    vmsp_unlock(vmsp);
+
+    // Physical mappings are always resolved at once
+    if ((flags & VMA_TYPE) == VMA_PHYS || (flags & VM_RESOLVE)) {
+        if (vmsp_populate(vmsp, base, length) != 0) {
+            vmsp_unmap(vmsp, base, length);
+            errno = ENOMEM;
+            return 0;
+        }
+    }
     errno = 0;
-    splock_unlock(&vmsp->lock);
     return base;
 }
 
 static vma_t *vma_check_range(vmsp_t *vmsp, vma_t *vma, size_t base, size_t length)
 {
     // char tmp1[32], tmp2[32];
-    assert(splock_locked(&vmsp->lock));
+    assert(vmsp_locked(vmsp));
     if (vma->node.value_ > base || vma->ops->split == NULL)
         return NULL;
 
@@ -380,15 +831,17 @@ static vma_t *vma_check_range(vmsp_t *vmsp, vma_t *vma, size_t base, size_t leng
     if (vma->node.value_ != base) {
         assert(base > vma->node.value_);
         size_t nlen = base - vma->node.value_;
-        vma_t *sec = kalloc(sizeof(vma_t));
+        vma_t *sec = vma_alloc(vmsp);
         sec->usage = 1;
         sec->node.value_ = base;
         sec->length = vma->length - nlen;
         vma->length = nlen;
+        bbtree_update(&vmsp->tree, &vma->node);
         sec->ops = vma->ops;
         vma->ops->split(vma, sec);
 
         bbtree_insert(&vmsp->tree, &sec->node);
+        vmsp->areas++;
         // kprintf(KL_VMA, "On %s%p, split vma %s/%s\n", VMS_NAME(vmsp), vmsp, vma->ops->print(vma, tmp1, 32), sec->ops->print(sec, tmp2, 32));
         vma = sec;
     }
@@ -408,15 +861,17 @@ static vma_t *vma_check_limit(vmsp_t *vmsp, vma_t *vma, size_t base, size_t leng
         return NULL;
 
     if (length < vma->length) {
-        vma_t *sec = kalloc(sizeof(vma_t));
+        vma_t *sec = vma_alloc(vmsp);
         sec->usage = 1;
         sec->node.value_ = base + length;
         sec->length = vma->length - length;
         vma->length = length;
+        bbtree_update(&vmsp->tree, &vma->node);
         sec->ops = vma->ops;
         vma->ops->split(vma, sec);
 
         bbtree_insert(&vmsp->tree, &sec->node);
+        vmsp->areas++;
         // kprintf(KL_VMA, "On %s%p, split vma %s/%s\n", VMS_NAME(vmsp), vmsp, vma->ops->print(vma, tmp1, 32), sec->ops->print(sec, tmp2, 32));
     }
 
@@ -425,23 +880,23 @@ static vma_t *vma_check_limit(vmsp_t *vmsp, vma_t *vma, size_t base, size_t leng
 
 int vmsp_unmap(vmsp_t *vmsp, size_t base, size_t length)
 {
-    splock_lock(&vmsp->lock);
+    vmsp_lock(vmsp);
     vma_t *vma = vmsp_find_area(vmsp, base);
     if (vma == NULL) {
-        splock_unlock(&vmsp->lock);
+        vmsp_unlock(vmsp);
         errno = EINVAL;
         return -1;
     }
 
     if (vma->node.value_ == base && vma->length == length) {
         vma_unmap(vmsp, vma);
-        splock_unlock(&vmsp->lock);
+        vmsp_unlock(vmsp);
         return 0;
     }
 
     vma_t *cur = vma_check_range(vmsp, vma, base, length);
     if (cur == NULL) {
-        splock_unlock(&vmsp->lock);
+        vmsp_unlock(vmsp);
         errno = EINVAL;
         return -1;
     }
@@ -452,35 +907,94 @@ int vmsp_unmap(vmsp_t *vmsp, size_t base, size_t length)
             break;
         vma_t *next = bbtree_next(&cur->node, vma_t, node);
         vma_unmap(vmsp, cur);
-        // TODO -- Can we merge front, can we merge back if last one close it
         if (next == NULL)
             break;
         cur = next;
     }
 
-    splock_unlock(&vmsp->lock);
+    vmsp_unlock(vmsp);
     return 0;
 }
 
+/* Move up to `count` private pages of anonymous areas to the swap. Pages
+ * are visited like a clock, from where the previous pass stopped. A page
+ * accessed since the last visit gets a second chance, so at most two turns
+ * are needed. */
+int vmsp_evict(vmsp_t *vmsp, int count)
+{
+    int done = 0;
+    vmsp_lock(vmsp);
+    size_t address = vmsp->evict_hand;
+    size_t turns = 2 * vmsp->v_size;
+    vma_t *vma = bbtree_search_le(&vmsp->tree, address, vma_t, node);
+    if (vma == NULL || address >= vma->node.value_ + vma->length) {
+        vma = vma != NULL ? bbtree_next(&vma->node, vma_t, node) : NULL;
+        if (vma == NULL)
+            vma = bbtree_first(&vmsp->tree, vma_t, node);
+        address = vma != NULL ? vma->node.value_ : 0;
+    }
+    while (vma != NULL && done < count && turns > 0) {
+        size_t limit = vma->node.value_ + vma->length;
+        if (vma->ops->evict == NULL) {
+            turns -= MIN(turns, (limit - address) / PAGE_SIZE);
+            address = limit;
+        }
+        for (; address < limit && done < count && turns > 0; address += PAGE_SIZE, --turns) {
+            if (!mmu_young(address) && vma->ops->evict(vmsp, vma, address) == 0)
+                done++;
+        }
+        if (address < limit)
+            break;
+        vma = bbtree_next(&vma->node, vma_t, node);
+        if (vma == NULL)
+            vma = bbtree_first(&vmsp->tree, vma_t, node);
+        address = vma->node.value_;
+    }
+    vmsp->evict_hand = address;
+    vmsp_unlock(vmsp);
+    return done;
+}
+
+int vmsp_merge(vmsp_t *vmsp)
+{
+    int done = 0;
+    vmsp_rdlock(vmsp);
+    vma_t *vma = bbtree_first(&vmsp->tree, vma_t, node);
+    while (vma != NULL) {
+        size_t limit = vma->node.value_ + vma->length;
+        if (vma->flags & VMA_MERGEABLE) {
+            for (size_t address = vma->node.value_; address < limit; address += PAGE_SIZE) {
+                if (merge_page(vmsp, vma, address) == 0)
+                    done++;
+            }
+        }
+        vma = bbtree_next(&vma->node, vma_t, node);
+    }
+    vmsp_rdunlock(vmsp);
+    return done;
+}
+
 int vmsp_protect(vmsp_t *vmsp, size_t base, size_t length, int flags)
 {
-    splock_lock(&vmsp->lock);
+    vmsp_lock(vmsp);
+    vmsp_install(vmsp, base, length);
     vma_t *vma = vmsp_find_area(vmsp, base);
     if (vma == NULL || vma->ops->protect == NULL) {
         errno = EINVAL;
-        splock_unlock(&vmsp->lock);
+        vmsp_unlock(vmsp);
         return -1;
     }
 
     if (vma->node.value_ == base && vma->length == length) {
         int ret = vma->ops->protect(vmsp, vma, flags);
-        splock_unlock(&vmsp->lock);
+        vmsp_merge_range(vmsp, base, length);
+        vmsp_unlock(vmsp);
         return ret;
     }
 
     vma_t *cur = vma_check_range(vmsp, vma, base, length);
     if (cur == NULL) {
-        splock_unlock(&vmsp->lock);
+        vmsp_unlock(vmsp);
         errno = EINVAL;
         return -1;
     }
@@ -491,36 +1005,97 @@ int vmsp_protect(vmsp_t *vmsp, size_t base, size_t length, int flags)
         if (cur == NULL)
             break;
         ret |= cur->ops->protect(vmsp, cur, flags);
-        // TODO -- Can we merge front, can we merge back
         cur = bbtree_next(&cur->node, vma_t, node);
         if (cur == NULL)
             break;
     }
 
-    splock_unlock(&vmsp->lock);
+    vmsp_merge_range(vmsp, base, length);
+
+    vmsp_unlock(vmsp);
     return ret;
 }
 
+int vmsp_advise(vmsp_t *vmsp, size_t base, size_t length, int advice)
+{
+    bool merging = advice == VMA_ADV_MERGEABLE || advice == VMA_ADV_UNMERGEABLE;
+    if (length == 0 || (base & (PAGE_SIZE - 1)) != 0 || (length & (PAGE_SIZE - 1)) != 0 || ((advice < VMA_ADV_NORMAL || advice > VMA_ADV_DONTNEED) && !merging)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    vmsp_lock(vmsp);
+    if (advice != VMA_ADV_DONTNEED)
+        vmsp_install(vmsp, base, length);
+    vma_t *vma = vmsp_find_area(vmsp, base);
+    vma_t *cur = vma != NULL ? vma_check_range(vmsp, vma, base, length) : NULL;
+    if (cur == NULL) {
+        vmsp_unlock(vmsp);
+        errno = EINVAL;
+        return -1;
+    }
+
+    for (;;) {
+        cur = vma_check_limit(vmsp, cur, base, length);
+        if (cur == NULL)
+            break;
+        if (advice == VMA_ADV_DONTNEED)
+            vma_drop_pages(vmsp, cur, cur->node.value_, cur->length);
+        else if (merging) {
+            // Only private anonymous pages can be merged
+            if (advice == VMA_ADV_MERGEABLE && cur->ops == &vma_ops_anon)
+                cur->flags |= VMA_MERGEABLE;
+            else if (advice == VMA_ADV_UNMERGEABLE && (cur->flags & VMA_MERGEABLE)) {
+                cur->flags &= ~VMA_MERGEABLE;
+                merge_undo(vmsp, cur);
+            }
+        } else if (advice != VMA_ADV_WILLNEED) {
+            cur->flags &= ~(VMA_SEQUENTIAL | VMA_RANDOM);
+            if (advice == VMA_ADV_SEQUENTIAL)
+                cur->flags |= VMA_SEQUENTIAL;
+            else if (advice == VMA_ADV_RANDOM)
+                cur->flags |= VMA_RANDOM;
+        }
+        cur = bbtree_next(&cur->node, vma_t, node);
+        if (cur == NULL)
+            break;
+    }
+
+    vmsp_merge_range(vmsp, base, length);
+    vmsp_unlock(vmsp);
+
+    // Faults take the space shared, bring the pages once released
+    if (advice == VMA_ADV_WILLNEED)
+        vmsp_populate(vmsp, base, length);
+    return 0;
+}
+
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 
+/* User spaces, they leave the list under its lock as their last user goes */
+static llhead_t __vmsp_list = INIT_LLHEAD;
+static splock_t __vmsp_lock = INIT_SPLOCK;
+
 static vmsp_t *vmsp_build()
 {
-    vmsp_t *vmsp = kalloc(sizeof(vmsp_t));
-    bbtree_init(&vmsp->tree);
-    splock_init(&vmsp->lock);
+    vmsp_t *vmsp = kzalloc(sizeof(vmsp_t));
+    bbtree_init_augmented(&vmsp->tree, vma_augment);
+    bbtree_init(&vmsp->swaps);
+    bbtree_init(&vmsp->deferred);
+    rwsem_init(&vmsp->lock);
+    splock_init(&vmsp->plock);
     vmsp->usage = 1;
     vmsp->max_size = VMSP_MAX_SIZE; // TODO -- configurable
     mmu_create_uspace(vmsp);
+    splock_lock(&__vmsp_lock);
+    ll_append(&__vmsp_list, &vmsp->node);
+    splock_unlock(&__vmsp_lock);
     return vmsp;
 }
 
 vmsp_t *vmsp_create()
 {
-    vmsp_t *vmsp = vmsp_build();
-    vmsp->share = kalloc(sizeof(page_sharing_t));
-    vmsp->share->usage = 1;
-    hmp_init(&vmsp->share->map, 16);
-    return vmsp;
+    return vmsp_build();
 }
 
 vmsp_t *vmsp_open(vmsp_t *vmsp)
@@ -533,48 +1108,63 @@ vmsp_t *vmsp_open(vmsp_t *vmsp)
 vmsp_t *vmsp_clone(vmsp_t *vmsp)
 {
     assert(vmsp != __mmu.kspace);
-    splock_lock(&vmsp->lock);
+    vmsp_lock(vmsp);
+    vmsp_install(vmsp, vmsp->lower_bound, vmsp->upper_bound - vmsp->lower_bound);
     vmsp_t *copy = vmsp_build();
     assert(vmsp->lower_bound == copy->lower_bound);
     assert(vmsp->upper_bound == copy->upper_bound);
 
-    copy->share = vmsp->share;
-    atomic_inc(&copy->share->usage);
     vma_t *vma = bbtree_first(&vmsp->tree, vma_t, node);
     while (vma != NULL) {
     	vma_clone(copy, vmsp, vma);
         vma = bbtree_next(&vma->node, vma_t, node);
     }
-    splock_unlock(&vmsp->lock);
+    vmsp_unlock(vmsp);
     return copy;
 }
 
+/* Open the user space after this one, or the first one, and close the
+ * previous one once its successor is held */
+vmsp_t *vmsp_next(vmsp_t *vmsp)
+{
+    splock_lock(&__vmsp_lock);
+    vmsp_t *next = vmsp != NULL ? ll_next(&vmsp->node, vmsp_t, node) : ll_first(&__vmsp_list, vmsp_t, node);
+    if (next != NULL)
+        atomic_inc(&next->usage);
+    splock_unlock(&__vmsp_lock);
+    if (vmsp != NULL)
+        vmsp_close(vmsp);
+    return next;
+}
+
 /* Release all VMAs */
 void vmsp_sweep(vmsp_t *vmsp)
 {
-	splock_lock(&vmsp->lock);
+	vmsp_lock(vmsp);
 	vma_t *vma = bbtree_first(&vmsp->tree, vma_t, node);
 	while (vma != NULL) {
         vma_unmap(vmsp, vma);
 		vma = bbtree_first(&vmsp->tree, vma_t, node);
 	}
-	splock_unlock(&vmsp->lock);
+	vmsp_unlock(vmsp);
 }
 
 void vmsp_close(vmsp_t *vmsp)
 {
     assert(vmsp != __mmu.kspace);
-    if (atomic_xadd(&vmsp->usage, -1) != 1)
+    splock_lock(&__vmsp_lock);
+    if (atomic_xadd(&vmsp->usage, -1) != 1) {
+        splock_unlock(&__vmsp_lock);
         return;
-    vmsp_sweep(vmsp);
-    if (atomic_xadd(&vmsp->share->usage, -1) == 1) {
-        assert(vmsp->share->map.count == 0);
-        hmp_destroy(&vmsp->share->map);
-        kfree(vmsp->share);
     }
+    ll_remove(&__vmsp_list, &vmsp->node);
+    splock_unlock(&__vmsp_lock);
+    vmsp_sweep(vmsp);
+    assert(vmsp->w_size == 0 && vmsp->d_size == 0);
     mmu_destroy_uspace(vmsp);
     if (vmsp->proc)
         dlib_destroy(vmsp->proc);
+    rwsem_destroy(&vmsp->lock);
     kfree(vmsp);
 }
 
@@ -595,22 +1185,37 @@ int vmsp_resolve(vmsp_t *vmsp, size_t address, bool missing, bool write)
     if (vmsp == NULL)
         return vmsp_fault(PF_ERR"Address is outside of addressable space '%p'\n", address);
 
-    splock_lock(&vmsp->lock);
-    vma_t *vma = vmsp_find_area(vmsp, address);
-    if (vma == NULL) {
-        splock_unlock(&vmsp->lock);
-        return vmsp_fault(PF_ERR"No mapping at this address '%p'\n", address);
-    }
+    // Under pressure the faulting task gives back pages of its own space,
+    // no other task can evict them
+    if (vmsp == __mmu.uspace && page_reclaim_needed() && can_sleep())
+        page_reclaim(VMSP_RECLAIM_PAGES, PGR_USPACE);
+
+    int ret;
+    vmsp_rdlock(vmsp);
+    do {
+        vma_t *vma = vmsp_find_area(vmsp, address);
+        if (vma == NULL) {
+            vmsp_rdunlock(vmsp);
+            return vmsp_fault(PF_ERR"No mapping at this address '%p'\n", address);
+        }
 
-    if (write && !(vma->flags & VM_WR)) {
-        splock_unlock(&vmsp->lock);
-        return vmsp_fault(PF_ERR"Can't write on read-only memory at '%p'\n", address);
-    }
+        if (write && !(vma->flags & VM_WR)) {
+            vmsp_rdunlock(vmsp);
+            return vmsp_fault(PF_ERR"Can't write on read-only memory at '%p'\n", address);
+        }
 
-    errno = 0;
-    size_t vaddr = ALIGN_DW(address, PAGE_SIZE);
-    int ret = vma_resolve(vmsp, vma, vaddr, missing, write);
-    splock_unlock(&vmsp->lock);
+        errno = 0;
+        __mmu.page_faults++;
+        size_t vaddr = ALIGN_DW(address, PAGE_SIZE);
+        if (missing && vmsp->d_size != 0) {
+            vmsp_install(vmsp, vaddr, PAGE_SIZE);
+            missing = mmu_read(vaddr) == 0;
+        }
+        atomic_inc(&vma->usage);
+        ret = vma_resolve(vmsp, vma, vaddr, missing, write);
+        vma_put(vma);
+    } while (ret > 0);
+    vmsp_rdunlock(vmsp);
     return ret;
 }
 
@@ -651,14 +1256,15 @@ void vma_debug(vma_t *vma)
 
 void vmsp_display(vmsp_t *vmsp)
 {
-    splock_lock(&vmsp->lock);
+    vmsp_rdlock(vmsp);
     kprintf(KL_DBG, "------------------------------------------------\n");
     kprintf(KL_DBG,
-        "%p-%p virtual: %d KB   private: %d KB   shared: %d KB   table: %d KB\n",
+        "%p-%p virtual: %d KB   private: %d KB   shared: %d KB   table: %d KB   huge: %d   swap: %d KB   areas: %d\n",
         vmsp->lower_bound, vmsp->upper_bound,
-        vmsp->v_size * KB, vmsp->p_size * KB, vmsp->s_size * KB, vmsp->t_size * KB);
+        vmsp->v_size * KB, vmsp->p_size * KB, vmsp->s_size * KB, vmsp->t_size * KB, vmsp->h_size, vmsp->w_size * KB,
+        vmsp->areas);
     kprintf(KL_DBG, "------------------------------------------------\n");
-    char *buf = kalloc(512);
+    char *buf = kzalloc(512);
     vma_t *vma = bbtree_first(&vmsp->tree, vma_t, node);
     while (vma) {
     vma_print(vma, buf, 512);
@@ -671,6 +1277,6 @@ void vmsp_display(vmsp_t *vmsp)
     vma = bbtree_next(&vma->node, vma_t, node);
     }
     kfree(buf);
-    splock_unlock(&vmsp->lock);
+    vmsp_rdunlock(vmsp);
 }
 
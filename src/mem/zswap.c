@@ -0,0 +1,365 @@
+/*
+ *      This file is part of the KoraOS project.
+ *  Copyright (C) 2015-2021  <Fabien Bavent>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   - - - - - - - - - - - - - - -
+ */
+#include <kernel/stdc.h>
+#include <kernel/memory.h>
+#include <kernel/slab.h>
+#include <kora/bbtree.h>
+#include <kora/splock.h>
+#include <kora/time.h>
+#include <assert.h>
+
+/* Swapped out pages are compressed in memory before going to the device.
+ * The writeback of the swap cache offers them to this store first, and a
+ * fault finds them back without any I/O. Pages which don't shrink enough,
+ * or which don't fit in the pool, are written on the swap area.
+ *
+ * The compressed data go into slab caches of a few size classes. The codec
+ * follows the LZ4 block format: each sequence starts with a token holding
+ * the count of literals and the length of the match on 4 bits each, longer
+ * values continue on extra bytes, and matches refer back by a 2 bytes offset.
+ */
+#define ZSWAP_HASH_BITS  10
+#define ZSWAP_MIN_MATCH  4
+#define ZSWAP_POOL_PART  8  /* Default pool size, as a part of the memory */
+#define ZSWAP_CLASSES  7
+
+typedef struct zswap_entry zswap_entry_t;
+
+struct zswap_entry
+{
+    bbnode_t node;  /* Slot number */
+    void *data;
+    uint16_t length;
+    uint8_t bucket;
+};
+
+struct zswap_pool
+{
+    bbtree_t tree;
+    splock_t lock;
+    size_t limit;
+    size_t used;  /* Bytes of slabs taken by the buckets */
+    size_t length;  /* Bytes of compressed data */
+    long stored;
+    long stores;
+    long loads;
+    long rejects;
+    xtime_t store_time;
+    xtime_t load_time;
+};
+
+struct zswap_pool __zswap;
+
+static kmem_cache_t zswap_cache = INIT_KMEM_CACHE("zswap", zswap_entry_t, NULL);
+/* Every class packs at least two objects on a slab page, sizes are cut to
+ * fill the page once the slab header is set apart */
+static kmem_cache_t zswap_buckets[ZSWAP_CLASSES] = {
+    { .name = "zswap-56", .size = 56, .flags = KMEM_NOZERO },
+    { .name = "zswap-120", .size = 120, .flags = KMEM_NOZERO },
+    { .name = "zswap-248", .size = 248, .flags = KMEM_NOZERO },
+    { .name = "zswap-504", .size = 504, .flags = KMEM_NOZERO },
+    { .name = "zswap-1008", .size = 1008, .flags = KMEM_NOZERO },
+    { .name = "zswap-1344", .size = 1344, .flags = KMEM_NOZERO },
+    { .name = "zswap-2016", .size = 2016, .flags = KMEM_NOZERO },
+};
+
+/* Scratch buffers of the compressor, the swap I/O mutex serializes stores */
+static uint16_t zswap_table[1 << ZSWAP_HASH_BITS];
+static uint8_t zswap_scratch[ZSWAP_MAX_SIZE];
+
+
+static inline uint32_t zswap_read32(const uint8_t *ptr)
+{
+    uint32_t value;
+    memcpy(&value, ptr, sizeof(value));
+    return value;
+}
+
+static inline int zswap_hash(uint32_t value)
+{
+    return (value * 2654435761U) >> (32 - ZSWAP_HASH_BITS);
+}
+
+static uint8_t *zswap_put_length(uint8_t *op, int length)
+{
+    if (length < 15)
+        return op;
+    for (length -= 15; length >= 255; length -= 255)
+        *op++ = 255;
+    *op++ = length;
+    return op;
+}
+
+static const uint8_t *zswap_get_length(const uint8_t *ip, const uint8_t *iend, int *length)
+{
+    if (*length < 15)
+        return ip;
+    int byte;
+    do {
+        if (ip >= iend)
+            return NULL;
+        byte = *ip++;
+        *length += byte;
+    } while (byte == 255);
+    return ip;
+}
+
+int zswap_compress(const uint8_t *src, uint8_t *dst, int max)
+{
+    const uint8_t *ip = src + 1;
+    const uint8_t *anchor = src;
+    const uint8_t *end = src + PAGE_SIZE;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + max;
+    memset(zswap_table, 0, sizeof(zswap_table));
+
+    while (ip + ZSWAP_MIN_MATCH <= end) {
+        uint32_t sequence = zswap_read32(ip);
+        int h = zswap_hash(sequence);
+        const uint8_t *ref = src + zswap_table[h];
+        zswap_table[h] = ip - src;
+        if (ref >= ip || zswap_read32(ref) != sequence) {
+            ip++;
+            continue;
+        }
+
+        const uint8_t *mp = ip + ZSWAP_MIN_MATCH;
+        for (ref += ZSWAP_MIN_MATCH; mp < end && *mp == *ref; ++ref)
+            mp++;
+        int literals = ip - anchor;
+        int match = mp - ip - ZSWAP_MIN_MATCH;
+        if (op + 5 + literals + literals / 255 + match / 255 > oend)
+            return 0;
+        uint8_t *token = op++;
+        *token = MIN(literals, 15) << 4 | MIN(match, 15);
+        op = zswap_put_length(op, literals);
+        memcpy(op, anchor, literals);
+        op += literals;
+        *op++ = (mp - ref) & 0xff;
+        *op++ = (mp - ref) >> 8;
+        op = zswap_put_length(op, match);
+        ip = anchor = mp;
+    }
+
+    // The last sequence only holds literals
+    int literals = end - anchor;
+    if (op + 2 + literals + literals / 255 > oend)
+        return 0;
+    *op++ = MIN(literals, 15) << 4;
+    op = zswap_put_length(op, literals);
+    memcpy(op, anchor, literals);
+    op += literals;
+    return op - dst;
+}
+
+int zswap_decompress(const uint8_t *src, int length, uint8_t *dst)
+{
+    const uint8_t *ip = src;
+    const uint8_t *iend = src + length;
+    uint8_t *op = dst;
+    uint8_t *oend = dst + PAGE_SIZE;
+    while (ip < iend) {
+        int token = *ip++;
+        int literals = token >> 4;
+        ip = zswap_get_length(ip, iend, &literals);
+        if (ip == NULL || ip + literals > iend || op + literals > oend)
+            return -1;
+        memcpy(op, ip, literals);
+        ip += literals;
+        op += literals;
+        if (ip >= iend)
+            break;
+
+        if (ip + 2 > iend)
+            return -1;
+        int offset = ip[0] | ip[1] << 8;
+        ip += 2;
+        int match = token & 15;
+        ip = zswap_get_length(ip, iend, &match);
+        match += ZSWAP_MIN_MATCH;
+        if (ip == NULL || offset == 0 || offset > op - dst || op + match > oend)
+            return -1;
+        // The copy might overlap its own output
+        const uint8_t *ref = op - offset;
+        while (match-- > 0)
+            *op++ = *ref++;
+    }
+    return op == oend ? 0 : -1;
+}
+
+static int zswap_bucket(int length)
+{
+    for (int i = 0; i < ZSWAP_CLASSES; ++i) {
+        if ((size_t)length <= zswap_buckets[i].size)
+            return i;
+    }
+    return -1;
+}
+
+/* Share of a slab page taken by an object of the bucket */
+static size_t zswap_footprint(int bucket)
+{
+    return PAGE_SIZE / zswap_buckets[bucket].per_slab;
+}
+
+static void zswap_remove(zswap_entry_t *entry)
+{
+    bbtree_remove(&__zswap.tree, entry->node.value_);
+    __zswap.used -= zswap_footprint(entry->bucket);
+    __zswap.length -= entry->length;
+    __zswap.stored--;
+}
+
+/* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
+
+void zswap_init()
+{
+    bbtree_init(&__zswap.tree);
+    splock_init(&__zswap.lock);
+    __zswap.limit = __mmu.pages_amount / ZSWAP_POOL_PART * PAGE_SIZE;
+}
+
+/* Change the size of the pool, return the previous one */
+size_t zswap_setup(size_t limit)
+{
+    splock_lock(&__zswap.lock);
+    size_t previous = __zswap.limit;
+    __zswap.limit = limit;
+    splock_unlock(&__zswap.lock);
+    return previous;
+}
+
+/* Keep a compressed copy of the page for this slot, the swap I/O mutex
+ * must be held. Return false if the page should go to the device. */
+bool zswap_store(long slot, size_t page)
+{
+    if (__zswap.used + zswap_buckets[0].size > __zswap.limit)
+        return false;
+    xtime_t start = xtime_read(XTIME_CLOCK);
+    int length = 0;
+    void *ptr = kmap_atomic(page, VM_RD);
+#ifdef KORA_KRN
+    length = zswap_compress(ptr, zswap_scratch, ZSWAP_MAX_SIZE);
+#endif
+    kunmap_atomic(ptr);
+    int bucket = zswap_bucket(length);
+    if (length == 0 || bucket < 0) {
+        splock_lock(&__zswap.lock);
+        __zswap.rejects++;
+        splock_unlock(&__zswap.lock);
+        return false;
+    }
+
+    zswap_entry_t *entry = kmem_cache_alloc(&zswap_cache);
+    if (entry == NULL)
+        return false;
+    entry->data = kmem_cache_alloc(&zswap_buckets[bucket]);
+    if (entry->data == NULL) {
+        kmem_cache_free(&zswap_cache, entry);
+        return false;
+    }
+    entry->node.value_ = slot;
+    entry->length = length;
+    entry->bucket = bucket;
+    memcpy(entry->data, zswap_scratch, length);
+
+    assert(zswap_buckets[bucket].per_slab >= 2);
+    size_t footprint = zswap_footprint(bucket);
+    splock_lock(&__zswap.lock);
+    if (__zswap.used + footprint > __zswap.limit) {
+        splock_unlock(&__zswap.lock);
+        kmem_cache_free(&zswap_buckets[bucket], entry->data);
+        kmem_cache_free(&zswap_cache, entry);
+        return false;
+    }
+    bbtree_insert(&__zswap.tree, &entry->node);
+    __zswap.used += footprint;
+    __zswap.length += length;
+    __zswap.stored++;
+    __zswap.stores++;
+    __zswap.store_time += xtime_read(XTIME_CLOCK) - start;
+    splock_unlock(&__zswap.lock);
+    return true;
+}
+
+/* Get back the content of a slot into a new page, if the slot is here */
+size_t zswap_load(long slot)
+{
+    splock_lock(&__zswap.lock);
+    zswap_entry_t *entry = bbtree_search_eq(&__zswap.tree, slot, zswap_entry_t, node);
+    splock_unlock(&__zswap.lock);
+    if (entry == NULL)
+        return 0;
+
+    // The slot is held by the caller, the entry can't go away
+    xtime_t start = xtime_read(XTIME_CLOCK);
+    size_t page = page_new();
+    if (page == 0)
+        return 0;
+    int ret = 0;
+    void *ptr = kmap_atomic(page, VM_RW);
+#ifdef KORA_KRN
+    ret = zswap_decompress(entry->data, entry->length, ptr);
+#endif
+    kunmap_atomic(ptr);
+    assert(ret == 0);
+
+    splock_lock(&__zswap.lock);
+    __zswap.loads++;
+    __zswap.load_time += xtime_read(XTIME_CLOCK) - start;
+    splock_unlock(&__zswap.lock);
+    return page;
+}
+
+/* Tell if the content of a slot is kept here */
+bool zswap_lookup(long slot)
+{
+    splock_lock(&__zswap.lock);
+    zswap_entry_t *entry = bbtree_search_eq(&__zswap.tree, slot, zswap_entry_t, node);
+    splock_unlock(&__zswap.lock);
+    return entry != NULL;
+}
+
+/* Forget the content of a released slot */
+void zswap_drop(long slot)
+{
+    splock_lock(&__zswap.lock);
+    zswap_entry_t *entry = bbtree_search_eq(&__zswap.tree, slot, zswap_entry_t, node);
+    if (entry != NULL)
+        zswap_remove(entry);
+    splock_unlock(&__zswap.lock);
+    if (entry == NULL)
+        return;
+    kmem_cache_free(&zswap_buckets[entry->bucket], entry->data);
+    kmem_cache_free(&zswap_cache, entry);
+}
+
+void zswap_info()
+{
+    if (__zswap.stores == 0)
+        return;
+    int ratio = __zswap.used != 0 ? (int)((long long)__zswap.stored * PAGE_SIZE * 100 / __zswap.used) : 0;
+    kprintf(KL_DBG, "Zswap:         %9s (%dK), %d pages, %d bytes of data, ratio %d.%02d\n",
+        sztoa(__zswap.used), (int)(__zswap.used / 1024), (int)__zswap.stored,
+        (int)__zswap.length, ratio / 100, ratio % 100);
+    kprintf(KL_DBG, "Zswap:  %d stores (%d us), %d loads (%d us), %d rejected\n",
+        (int)__zswap.stores, (int)__zswap.store_time, (int)__zswap.loads,
+        (int)__zswap.load_time, (int)__zswap.rejects);
+}
@@ -192,8 +192,8 @@ void eth_setup(netstack_t* stack)
     if (proto != NULL)
         return;
 
-    proto = kalloc(sizeof(nproto_t));
-    eth_info_t *info = kalloc(sizeof(eth_info_t));
+    proto = kzalloc(sizeof(nproto_t));
+    eth_info_t *info = kzalloc(sizeof(eth_info_t));
     hmp_init(&info->recv_map, 8);
     proto->receive = eth_receive;
     proto->data = info;
@@ -174,8 +174,8 @@ int lo_setup(netstack_t *stack)
     if (proto != NULL)
         return -1;
 
-    proto = kalloc(sizeof(nproto_t));
-    lo_info_t *info = kalloc(sizeof(lo_info_t));
+    proto = kzalloc(sizeof(nproto_t));
+    lo_info_t *info = kzalloc(sizeof(lo_info_t));
     hmp_init(&info->recv_map, 8);
     proto->receive = lo_receive;
     proto->data = info;
@@ -40,7 +40,7 @@ static void net_handle_event(skb_t *skb)
         hnode = ll_next(&hnode->node, nhandler_t, node);
         splock_unlock(&stack->lock);
     }
-    kfree(skb);
+    net_skb_free(skb);
 }
 
 /* Push an event on an interface device (connected/disconnected) */
@@ -51,9 +51,7 @@ int net_event(ifnet_t *net, int event, int param)
         return -1;
     assert(net->stack != NULL);
     int len = 2 * sizeof(int);
-    skb_t *skb = kalloc(sizeof(skb_t) + len);
-    skb->ifnet = net;
-    skb->size = len;
+    skb_t *skb = net_skb_alloc(net, len);
     skb->protocol = NET_AF_EVT;
     int *ptr = net_skb_reserve(skb, len);
     if (ptr == NULL)
@@ -77,7 +75,7 @@ void net_handler(netstack_t *stack, void(*handler)(ifnet_t *, int, int))
     assert(stack != NULL);
     if (handler == NULL)
         return;
-    nhandler_t *hnode = kalloc(sizeof(nhandler_t));
+    nhandler_t *hnode = kzalloc(sizeof(nhandler_t));
     hnode->handler = handler;
     splock_lock(&stack->lock);
     ll_append(&stack->handlers, &hnode->node);
@@ -187,7 +185,7 @@ ifnet_t *net_device(netstack_t *stack, int protocol, uint8_t *hwaddr, net_ops_t
 
     // Allocate the new interface
     int uid = atomic_xadd(&stack->id_max, 1);
-    ifnet_t *net = kalloc(sizeof(ifnet_t));
+    ifnet_t *net = kzalloc(sizeof(ifnet_t));
     net->protocol = protocol;
     net->mtu = 1500;
     net->idx = uid;
@@ -218,7 +216,7 @@ ifnet_t *net_device(netstack_t *stack, int protocol, uint8_t *hwaddr, net_ops_t
 /* Create the network stack (non static only for testing) */
 netstack_t *net_create_stack()
 {
-    netstack_t *stack = kalloc(sizeof(netstack_t));
+    netstack_t *stack = kzalloc(sizeof(netstack_t));
     sem_init(&stack->rx_sem, 0);
     splock_init(&stack->rx_lock);
     splock_init(&stack->lock);
@@ -341,7 +339,7 @@ void net_deamon(netstack_t *stack)
             skb->ifnet->rx_dropped++;
             kprintf(-1, "Rx dropped %s:%s%d %s\n", 
                 skb->ifnet->stack->hostname, skb->ifnet->proto->name, skb->ifnet->idx, skb->log);
-            kfree(skb);
+            net_skb_free(skb);
         }
     }
     stack->running = -1;
@@ -19,17 +19,50 @@
  */
 #include <kernel/net.h>
 #include <kernel/stdc.h>
+#include <kernel/slab.h>
 #include <kora/mcrs.h>
 
+/* Packets up to an ethernet frame are served by the cache */
+#define SKB_CACHED_SIZE  1536
+
+static kmem_cache_t skb_cache = {
+    .name = "skb",
+    .size = sizeof(skb_t) + SKB_CACHED_SIZE,
+    .flags = KMEM_NOZERO,
+};
+
+/* Allocate a packet able to hold `len' bytes, only the header is cleared */
+skb_t *net_skb_alloc(ifnet_t *net, unsigned len)
+{
+    skb_t *skb;
+    if (len <= SKB_CACHED_SIZE)
+        skb = kmem_cache_alloc(&skb_cache);
+    else
+        skb = kalloc(sizeof(skb_t) + len);
+    memset(skb, 0, sizeof(skb_t));
+    skb->ifnet = net;
+    skb->size = len;
+    return skb;
+}
+
+/* Release a packet */
+void net_skb_free(skb_t *skb)
+{
+    if (skb->size <= SKB_CACHED_SIZE)
+        kmem_cache_free(&skb_cache, skb);
+    else
+        kfree(skb);
+}
+
 /* Create a new tx packet */
 skb_t *net_packet(ifnet_t *net)
 {
     if (net == NULL)
         return NULL;
     int len = MAX(1500, net->mtu);
-    skb_t *skb = kalloc(sizeof(skb_t) + len);
-    skb->ifnet = net;
-    skb->size = len;
+    skb_t *skb = net_skb_alloc(net, len);
+    // Headers are written piecemeal, keep unset fields cleared
+    memset(skb->buf, 0, len);
     return skb;
 }
 
@@ -38,9 +71,7 @@ void net_skb_recv(ifnet_t *net, uint8_t *buf, unsigned len)
 {
     assert(net != NULL && net->stack != NULL && buf != NULL);
     netstack_t *stack = net->stack;
-    skb_t *skb = kalloc(sizeof(skb_t) + len);
-    skb->size = len;
-    skb->ifnet = net;
+    skb_t *skb = net_skb_alloc(net, len);
     memcpy(skb->buf, buf, len);
     skb->length = len;
     skb->protocol = net->protocol;
@@ -67,7 +98,7 @@ int net_skb_send(skb_t *skb)
         skb->ifnet->tx_errors++;
     else
         skb->ifnet->tx_bytes += skb->length;
-    kfree(skb);
+    net_skb_free(skb);
     return ret;
 }
 
@@ -79,7 +110,7 @@ int net_skb_trash(skb_t *skb)
     kprintf(-1, "Error on packet %s \n", skb->log);
     skb->ifnet->tx_packets++;
     skb->ifnet->tx_dropped++;
-    kfree(skb);
+    net_skb_free(skb);
     return -1;
 }
 
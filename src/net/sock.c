@@ -30,7 +30,7 @@ static socket_t *net_socket_from(socket_t *model, skb_t *skb)
         return NULL;
 
     // Allocate the socket
-    socket_t *sock = kalloc(sizeof(socket_t));
+    socket_t *sock = kzalloc(sizeof(socket_t));
     sock->stack = model->stack;
     sock->proto = model->proto;
     sock->protocol = model->protocol;
@@ -56,7 +56,7 @@ socket_t *net_socket(netstack_t *stack, int protocol, int method)
         return NULL; // No such protocol or is not socket capable
 
     // Allocate the socket
-    socket_t *sock = kalloc(sizeof(socket_t));
+    socket_t *sock = kzalloc(sizeof(socket_t));
     sock->stack = stack;
     sock->proto = proto;
     sock->protocol = protocol;
@@ -184,7 +184,7 @@ long net_socket_recv(socket_t *sock, netmsg_t *msg, int flags)
 /* Writing data to a socket */
 long net_socket_write(socket_t *sock, const char *buf, size_t len, int flags)
 {
-    netmsg_t *msg = kalloc(sizeof(netmsg_t) + sizeof(iovec_t));
+    netmsg_t *msg = kzalloc(sizeof(netmsg_t) + sizeof(iovec_t));
     msg->iolven = 1;
     msg->iov[0].buf = (char *)buf;
     msg->iov[0].len = len;
@@ -196,7 +196,7 @@ long net_socket_write(socket_t *sock, const char *buf, size_t len, int flags)
 /* Reading data from a socket */
 long net_socket_read(socket_t *sock, char *buf, size_t len, int flags)
 {
-    netmsg_t *msg = kalloc(sizeof(netmsg_t) + sizeof(iovec_t));
+    netmsg_t *msg = kzalloc(sizeof(netmsg_t) + sizeof(iovec_t));
     msg->iolven = 1;
     msg->iov[0].buf = buf;
     msg->iov[0].len = len;
@@ -21,8 +21,10 @@
 #define _KORA_ALLOCATOR_H 1
 
 #include <stddef.h>
+#include <stdint.h>
 #include <kora/splock.h>
 #include <kora/llist.h>
+#include <kora/bbtree.h>
 #include <kora/mcrs.h>
 
 #define HEAP_PARANO  (1 << 0)
@@ -32,6 +34,12 @@
 #define HEAP_MAPPED  (1 << 4)
 #define HEAP_OPTIONS  (HEAP_PARANO | HEAP_CHECK)
 
+/* Free chunks are sorted into bins, one per size under HEAP_SMALL_LIMIT
+ * then four per power of two. */
+#define HEAP_SMALL_LIMIT  512
+#define HEAP_SMALL_BINS  (HEAP_SMALL_LIMIT / 8)
+#define HEAP_BINS  160
+
 typedef struct heap_arena heap_arena_t;
 typedef struct heap_chunk heap_chunk_t;
 
@@ -42,8 +50,10 @@ struct heap_arena {
     size_t max_chunk;
     int flags_;
     splock_t lock_;
-    heap_chunk_t *free_;
+    heap_chunk_t *bins_[HEAP_BINS];
+    uint32_t map_[HEAP_BINS / 32];
     llnode_t node_;
+    bbnode_t bnode_;
 };
 
 
@@ -54,6 +64,12 @@ void setup_arena(heap_arena_t *arena, size_t address, size_t length,
 void *malloc_r(heap_arena_t *arena, size_t size);
 /* Release a block of memory previously allocated on the same arena */
 void free_r(heap_arena_t *arena, void *ptr);
+/* Resize a block of memory without moving it, return NULL if it can't */
+void *realloc_r(heap_arena_t *arena, void *ptr, size_t size);
+/* Usable size of a block of memory allocated on an arena */
+size_t msize_r(void *ptr);
+/* Usable size of the block malloc_r would cut for a request */
+size_t msize_fit_r(size_t size);
 
 /* Dynamicaly allocate a block of memory on the address space */
 void *_PRT(malloc)(size_t size);
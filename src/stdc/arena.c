@@ -19,6 +19,7 @@
  */
 #include <assert.h>
 #include <string.h>
+#include <stdbool.h>
 #include "allocator.h"
 #include <errno.h>
 
@@ -26,7 +27,7 @@
 
 #define HEAP_HEADER 8
 #define HEAP_ALIGN 8
-#define HEAP_MIN_CHUNK 16
+#define HEAP_MIN_CHUNK (HEAP_HEADER + 2 * sizeof(void *))
 
 struct heap_chunk {
     unsigned int size_;
@@ -44,6 +45,28 @@ struct heap_chunk {
 #define arena_prev_chunk(c)  ((heap_chunk_t *)(((size_t)(c))-(c)->prsz_))
 #define arena_next_chunk(c)  ((heap_chunk_t *)(((size_t)(c))+(c)->size_))
 
+/* Index of the bin holding free chunks of `size' bytes */
+static inline int arena_bin(size_t size)
+{
+    if (size < HEAP_SMALL_LIMIT)
+        return size >> 3;
+    int lg = 31 - __builtin_clz(size);
+    return HEAP_SMALL_BINS + ((lg - 9) << 2) + ((size >> (lg - 2)) & 3);
+}
+
+/* First non-empty bin starting at `bin', or -1 */
+static int arena_bin_next(heap_arena_t *arena, int bin)
+{
+    int i = bin / 32;
+    uint32_t word = arena->map_[i] & (~0U << (bin % 32));
+    while (word == 0) {
+        if (++i >= HEAP_BINS / 32)
+            return -1;
+        word = arena->map_[i];
+    }
+    return i * 32 + __builtin_ctz(word);
+}
+
 static void arena_freelist_rm(heap_arena_t *arena, heap_chunk_t *chunk)
 {
     assert(splock_locked(&arena->lock_));
@@ -56,8 +79,10 @@ static void arena_freelist_rm(heap_arena_t *arena, heap_chunk_t *chunk)
         chunk->g_.f_.prev_->g_.f_.next_ = chunk->g_.f_.next_;
 
     else {
-        /* TODO multi free list */
-        arena->free_ = chunk->g_.f_.next_;
+        int bin = arena_bin(chunk->size_);
+        arena->bins_[bin] = chunk->g_.f_.next_;
+        if (arena->bins_[bin] == NULL)
+            arena->map_[bin / 32] &= ~(1U << (bin % 32));
     }
 
     chunk->g_.f_.prev_ = (heap_chunk_t *)POISON_PTR;
@@ -66,33 +91,36 @@ static void arena_freelist_rm(heap_arena_t *arena, heap_chunk_t *chunk)
 
 static void arena_freelist_add(heap_arena_t *arena, heap_chunk_t *chunk)
 {
-    /* TODO multi free list */
-    heap_chunk_t **list = &arena->free_;
-    heap_chunk_t *cur = arena->free_;
+    int bin = arena_bin(chunk->size_);
+    heap_chunk_t *cur = arena->bins_[bin];
     assert(splock_locked(&arena->lock_));
     chunk->isfree_ = 1;
     arena->used_ -= chunk->size_;
-    if (cur == NULL) { /* Only free chunk */
-        *list = chunk;
-        chunk->g_.f_.prev_ = NULL;
-        chunk->g_.f_.next_ = NULL;
-
-    } else if (cur->size_ >= chunk->size_) { /* Smallest chunk */
-        *list = chunk;
-        chunk->g_.f_.prev_ = NULL;
-        chunk->g_.f_.next_ = cur;
+    chunk->g_.f_.prev_ = NULL;
+    chunk->g_.f_.next_ = cur;
+    if (cur != NULL)
         cur->g_.f_.prev_ = chunk;
-    } else {
-
-        while (cur->g_.f_.next_ && cur->g_.f_.next_->size_ >= chunk->size_)
-            cur = cur->g_.f_.next_;
+    arena->bins_[bin] = chunk;
+    arena->map_[bin / 32] |= 1U << (bin % 32);
+}
 
-        if (cur->g_.f_.next_)
-            cur->g_.f_.next_->g_.f_.prev_ = chunk;
-        chunk->g_.f_.prev_ = cur;
-        chunk->g_.f_.next_ = cur->g_.f_.next_;
-        cur->g_.f_.next_ = chunk;
+/* Look for a free chunk of at least `len' bytes */
+static heap_chunk_t *arena_freelist_find(heap_arena_t *arena, size_t len)
+{
+    heap_chunk_t *cur;
+    int bin = arena_bin(len);
+    if (bin >= HEAP_SMALL_BINS) {
+        // Larger bins mix sizes, the first fitting chunk is taken
+        for (cur = arena->bins_[bin]; cur != NULL; cur = cur->g_.f_.next_) {
+            if (cur->size_ >= len)
+                return cur;
+        }
+        bin++;
     }
+
+    // Any chunk of the following bins is large enough
+    bin = arena_bin_next(arena, bin);
+    return bin < 0 ? NULL : arena->bins_[bin];
 }
 
 static heap_chunk_t *arena_split_chunk(heap_arena_t *arena,
@@ -147,8 +175,17 @@ static int arena_check(heap_arena_t *arena)
         chunk = next;
     }
 
-    // Check free list...
-
+    // Check free lists
+    for (int bin = 0; bin < HEAP_BINS; ++bin) {
+        heap_chunk_t *prev = NULL;
+        bool empty = (arena->map_[bin / 32] & (1U << (bin % 32))) == 0;
+        assert(empty == (arena->bins_[bin] == NULL));
+        for (chunk = arena->bins_[bin]; chunk; chunk = chunk->g_.f_.next_) {
+            assert(chunk->isfree_ && arena_bin(chunk->size_) == bin);
+            assert(chunk->g_.f_.prev_ == prev);
+            prev = chunk;
+        }
+    }
     return 0;
 }
 
@@ -175,8 +212,6 @@ void setup_arena(heap_arena_t *arena, size_t address, size_t length,
 /* Allocate a block of memory into an arena */
 void *malloc_r(heap_arena_t *arena, size_t len)
 {
-    size_t ck_size = 0;
-    heap_chunk_t *ck_prev = NULL;
     heap_chunk_t *cur;
     heap_chunk_t *split;
 
@@ -193,47 +228,39 @@ void *malloc_r(heap_arena_t *arena, size_t len)
         return NULL;
     }
 
-    /* Browse the free chunk list */
-    /* TODO multi free list */
-    for (cur = arena->free_; cur != NULL; cur = cur->g_.f_.next_) {
-
-        /* If we ask for heap corruption checks */
-        if (arena->flags_ & HEAP_CHECK) {
-            if (cur->g_.f_.prev_ != ck_prev || cur->size_ < ck_size) {
-                arena->flags_ |= HEAP_CORRUPTED;
-                splock_unlock(&arena->lock_);
-                errno = -1;
-                return NULL;
-            }
-
-            ck_size = cur->size_;
-            ck_prev = cur;
-        }
-
-        /* Loop until the chunk is too small. */
-        if (cur->size_ < len)
-            continue;
-
-        arena_freelist_rm(arena, cur);
-        if (cur->size_ >= len + HEAP_MIN_CHUNK) {
-            split = arena_split_chunk(arena, cur, len);
-            arena_freelist_add(arena, split);
-        }
+    cur = arena_freelist_find(arena, len);
+    if (cur == NULL) {
+        splock_unlock(&arena->lock_);
+        errno = ENOMEM;
+        return NULL;
+    }
 
-        if (arena->flags_ & HEAP_PARANO && arena_check(arena)) {
+    /* If we ask for heap corruption checks */
+    if (arena->flags_ & HEAP_CHECK) {
+        if (!cur->isfree_ || cur->size_ < len ||
+            (cur->g_.f_.next_ != NULL && cur->g_.f_.next_->g_.f_.prev_ != cur)) {
+            arena->flags_ |= HEAP_CORRUPTED;
             splock_unlock(&arena->lock_);
             errno = -1;
             return NULL;
         }
+    }
+
+    arena_freelist_rm(arena, cur);
+    if (cur->size_ >= len + HEAP_MIN_CHUNK) {
+        split = arena_split_chunk(arena, cur, len);
+        arena_freelist_add(arena, split);
+    }
 
+    if (arena->flags_ & HEAP_PARANO && arena_check(arena)) {
         splock_unlock(&arena->lock_);
-        errno = 0;
-        return cur->g_.data_;
+        errno = -1;
+        return NULL;
     }
 
     splock_unlock(&arena->lock_);
-    errno = ENOMEM;
-    return NULL;
+    errno = 0;
+    return cur->g_.data_;
 }
 
 /* Release a block of memory previously allocated on the same arena */
@@ -284,3 +311,69 @@ void free_r(heap_arena_t *arena, void *ptr)
     splock_unlock(&arena->lock_);
     errno = 0;
 }
+
+/* Resize a block of memory without moving it, return NULL if it can't */
+void *realloc_r(heap_arena_t *arena, void *ptr, size_t len)
+{
+    heap_chunk_t *chunk = itemof(ptr, heap_chunk_t, g_.data_);
+    heap_chunk_t *next;
+    heap_chunk_t *split;
+    size_t limit = arena->address_ + arena->length_;
+
+    assert((size_t)chunk >= arena->address_ && (size_t)chunk < limit);
+    len = ALIGN_UP(MAX(len + HEAP_HEADER, HEAP_MIN_CHUNK), HEAP_ALIGN);
+    if (len > arena->max_chunk) {
+        errno = EINVAL;
+        return NULL;
+    }
+
+    splock_lock(&arena->lock_);
+    if (arena->flags_ & HEAP_PARANO && arena_check(arena)) {
+        splock_unlock(&arena->lock_);
+        errno = -1;
+        return NULL;
+    }
+
+    /* Grow by absorbing the following chunk if it is free */
+    next = arena_next_chunk(chunk);
+    if (chunk->size_ < len) {
+        if ((size_t)next >= limit || !next->isfree_ || chunk->size_ + next->size_ < len) {
+            splock_unlock(&arena->lock_);
+            errno = ENOMEM;
+            return NULL;
+        }
+        arena_freelist_rm(arena, next);
+        arena_collapse(arena, chunk, next);
+    }
+
+    /* Give back the tail, merged with the following chunk if it is free */
+    if (chunk->size_ >= len + HEAP_MIN_CHUNK) {
+        split = arena_split_chunk(arena, chunk, len);
+        next = arena_next_chunk(split);
+        if ((size_t)next < limit && next->isfree_) {
+            arena_freelist_rm(arena, next);
+            arena_collapse(arena, split, next);
+        }
+        arena_freelist_add(arena, split);
+    }
+
+    if (arena->flags_ & HEAP_PARANO)
+        arena_check(arena);
+
+    splock_unlock(&arena->lock_);
+    errno = 0;
+    return ptr;
+}
+
+/* Usable size of a block of memory allocated on an arena */
+size_t msize_r(void *ptr)
+{
+    heap_chunk_t *chunk = itemof(ptr, heap_chunk_t, g_.data_);
+    return chunk->size_ - HEAP_HEADER;
+}
+
+/* Usable size of the block malloc_r would cut for a request */
+size_t msize_fit_r(size_t len)
+{
+    return ALIGN_UP(MAX(len + HEAP_HEADER, HEAP_MIN_CHUNK), HEAP_ALIGN) - HEAP_HEADER;
+}
@@ -38,6 +38,22 @@ void bbtree_init(bbtree_t *tree)
 {
     tree->root_ = __NIL;
     tree->count_ = 0;
+    tree->augment_ = NULL;
+}
+
+/* Augmented trees keep on each node a summary of its subtree */
+void bbtree_init_augmented(bbtree_t *tree, bbaugment_t augment)
+{
+    bbtree_init(tree);
+    tree->augment_ = augment;
+}
+
+static void bbtree_augment_(bbnode_t *node, bbaugment_t augment)
+{
+    if (augment == NULL || node == __NIL)
+        return;
+    augment(node, node->left_ != __NIL ? node->left_ : NULL,
+            node->right_ != __NIL ? node->right_ : NULL);
 }
 
 /* Swap the pointers of horizontal left links.
@@ -46,7 +62,7 @@ void bbtree_init(bbtree_t *tree)
 *   / \    \     =>    /    / \
 *  A   B    R         A    B   R
 */
-static bbnode_t *bbtree_skew(bbnode_t *node)
+static bbnode_t *bbtree_skew(bbnode_t *node, bbaugment_t augment)
 {
     bbnode_t *temp, *parent;
     if (node == __NIL || node->left_->level_ != node->level_)
@@ -59,6 +75,8 @@ static bbnode_t *bbtree_skew(bbnode_t *node)
     temp->right_ = node;
     node->parent_ = temp;
     temp->parent_ = parent;
+    bbtree_augment_(node, augment);
+    bbtree_augment_(temp, augment);
     return temp;
 }
 
@@ -71,7 +89,7 @@ static bbnode_t *bbtree_skew(bbnode_t *node)
 *                        / \
 *                       A   B
 */
-static bbnode_t *bbtree_split(bbnode_t *node)
+static bbnode_t *bbtree_split(bbnode_t *node, bbaugment_t augment)
 {
     bbnode_t *temp, *parent;
     if (node == __NIL || node->right_->right_->level_ != node->level_)
@@ -85,54 +103,61 @@ static bbnode_t *bbtree_split(bbnode_t *node)
     node->parent_ = temp;
     temp->level_++;
     temp->parent_ = parent;
+    bbtree_augment_(node, augment);
+    bbtree_augment_(temp, augment);
     return temp;
 }
 
-static bbnode_t *bbtree_insert_(bbnode_t *root, bbnode_t *node, int *ok)
+static bbnode_t *bbtree_insert_(bbnode_t *root, bbnode_t *node, bbaugment_t augment, int *ok)
 {
     if (root == __NIL) {
         node->level_ = 1;
         node->left_ = __NIL;
         node->right_ = __NIL;
         node->parent_ = __NIL;
+        bbtree_augment_(node, augment);
         *ok = 1;
         return node;
     }
 
     if (node->value_ < root->value_) {
-        root->left_ = bbtree_insert_(root->left_, node, ok);
+        root->left_ = bbtree_insert_(root->left_, node, augment, ok);
         root->left_->parent_ = root;
     } else if (node->value_ > root->value_) {
-        root->right_ = bbtree_insert_(root->right_, node, ok);
+        root->right_ = bbtree_insert_(root->right_, node, augment, ok);
         root->right_->parent_ = root;
     } else {
         *ok = 0;
         return root; // No insert
     }
 
-    root = bbtree_skew(root);
-    root = bbtree_split(root);
+    bbtree_augment_(root, augment);
+    root = bbtree_skew(root, augment);
+    root = bbtree_split(root, augment);
     return root;
 }
 
-static bbnode_t *bbtree_rebalance(bbnode_t *root)
+static bbnode_t *bbtree_rebalance(bbnode_t *root, bbaugment_t augment)
 {
     if (root->left_->level_ < root->level_ - 1 ||
         root->right_->level_ < root->level_ - 1) {
         root->level_--;
         if (root->right_->level_ > root->level_)
             root->right_->level_ = root->level_;
-        root = bbtree_skew(root);
-        root->right_ = bbtree_skew(root->right_);
-        root->right_->right_ = bbtree_skew(root->right_->right_);
-        root = bbtree_split(root);
-        root->right_ = bbtree_split(root->right_);
+        root = bbtree_skew(root, augment);
+        root->right_ = bbtree_skew(root->right_, augment);
+        root->right_->right_ = bbtree_skew(root->right_->right_, augment);
+        bbtree_augment_(root->right_, augment);
+        bbtree_augment_(root, augment);
+        root = bbtree_split(root, augment);
+        root->right_ = bbtree_split(root->right_, augment);
+        bbtree_augment_(root, augment);
     }
     return root;
 }
 
 static bbnode_t *bbtree_remove_(bbnode_t *root, size_t value, bbrm_t *del,
-                                int *ok)
+                                bbaugment_t augment, int *ok)
 {
     *ok = 0;
     if (root == __NIL)
@@ -141,11 +166,11 @@ static bbnode_t *bbtree_remove_(bbnode_t *root, size_t value, bbrm_t *del,
     // Search down the tree and set pointers last and deleted
     del->last = root;
     if (value < root->value_) {
-        root->left_ = bbtree_remove_(root->left_, value, del, ok);
+        root->left_ = bbtree_remove_(root->left_, value, del, augment, ok);
         root->left_->parent_ = root;
     } else {
         del->deleted = root;
-        root->right_ = bbtree_remove_(root->right_, value, del, ok);
+        root->right_ = bbtree_remove_(root->right_, value, del, augment, ok);
         root->right_->parent_ = root;
     }
 
@@ -159,8 +184,8 @@ static bbnode_t *bbtree_remove_(bbnode_t *root, size_t value, bbrm_t *del,
 
     // On the way back, we rebalance
     bbnode_t *node = root;
-    root = bbtree_rebalance(root);
-    bbtree_check(root);
+    bbtree_augment_(root, augment);
+    root = bbtree_rebalance(root, augment);
 
     if (node != del->deleted)
         return root;
@@ -186,14 +211,19 @@ static bbnode_t *bbtree_remove_(bbnode_t *root, size_t value, bbrm_t *del,
     }
     if (root == del->deleted)
         root = del->last;
-    bbtree_check(root);
+    // The summaries up to the subtree root still account the removed node
+    for (node = del->last; augment != NULL && node != __NIL; node = node->parent_) {
+        bbtree_augment_(node, augment);
+        if (node == root)
+            break;
+    }
     return root;
 }
 
 int bbtree_insert(bbtree_t *tree, bbnode_t *node)
 {
     int ok;
-    tree->root_ = bbtree_insert_(tree->root_, node, &ok);
+    tree->root_ = bbtree_insert_(tree->root_, node, tree->augment_, &ok);
     if (ok) {
         tree->count_++;
         return 0;
@@ -206,7 +236,7 @@ int bbtree_remove(bbtree_t *tree, size_t value)
     int ok;
     bbrm_t del;
     del.deleted = __NIL;
-    tree->root_ = bbtree_remove_(tree->root_, value, &del, &ok);
+    tree->root_ = bbtree_remove_(tree->root_, value, &del, tree->augment_, &ok);
     if (ok) {
         tree->count_--;
         return 0;
@@ -214,6 +244,23 @@ int bbtree_remove(bbtree_t *tree, size_t value)
     return -1;
 }
 
+/* Refresh the summaries from a node whose range changed up to the root */
+void bbtree_update(bbtree_t *tree, bbnode_t *node)
+{
+    for (; tree->augment_ != NULL && node != __NIL; node = node->parent_)
+        bbtree_augment_(node, tree->augment_);
+}
+
+/* Return a direct child, or the node itself, NULL for the leaves */
+bbnode_t *bbtree_child_(bbnode_t *node, int side)
+{
+    if (side < 0)
+        node = node->left_;
+    else if (side > 0)
+        node = node->right_;
+    return node != __NIL ? node : NULL;
+}
+
 /* Find the node on extreme left side  */
 bbnode_t *bbtree_left_(bbnode_t *node)
 {
@@ -330,6 +377,9 @@ int bbtree_check(bbnode_t *node)
 EXPORT_SYMBOL(bbtree_init, 0);
 EXPORT_SYMBOL(bbtree_insert, 0);
 EXPORT_SYMBOL(bbtree_remove, 0);
+EXPORT_SYMBOL(bbtree_init_augmented, 0);
+EXPORT_SYMBOL(bbtree_update, 0);
+EXPORT_SYMBOL(bbtree_child_, 0);
 EXPORT_SYMBOL(bbtree_left_, 0);
 EXPORT_SYMBOL(bbtree_right_, 0);
 EXPORT_SYMBOL(bbtree_next_, 0);
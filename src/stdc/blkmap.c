@@ -37,7 +37,7 @@ static void *blk_map_(blkmap_t *map, size_t no, int rights)
 
 static blkmap_t *blk_clone_(blkmap_t *map)
 {
-    blkmap_t *map2 = kalloc(sizeof(blkmap_t));
+    blkmap_t *map2 = kzalloc(sizeof(blkmap_t));
     map2->ino = vfs_open_inode(map->ino);
     map2->block = map->block;
     map2->msize = map->msize;
@@ -59,7 +59,7 @@ blkmap_t *blk_open(inode_t *ino, size_t blocksize)
 {
     if (!POW2(blocksize))
         return NULL;
-    blkmap_t *map = kalloc(sizeof(blkmap_t));
+    blkmap_t *map = kzalloc(sizeof(blkmap_t));
     map->ino = vfs_open_inode(ino);
     map->block = blocksize;
     map->msize = ALIGN_UP(blocksize, PAGE_SIZE);
@@ -28,52 +28,145 @@
 #define mmap(s) kmap(s, NULL, 0, VMA_HEAP | VM_RW);
 #define unmap(a,s) kunmap(a, s);
 
+int cpu_no();
 
+/* Per-CPU caches of recently freed small chunks */
+#define HEAP_TCACHE_CPUS  16
+#define HEAP_TCACHE_BINS  32
+#define HEAP_TCACHE_COUNT  16
+
+typedef struct heap_tcache heap_tcache_t;
+struct heap_tcache {
+    splock_t lock;
+    int count[HEAP_TCACHE_BINS];
+    void *bins[HEAP_TCACHE_BINS];
+};
 
 static int __empty_arena = 0;
+#ifndef NDEBUG
 static int __arena_option = HEAP_CHECK;
+#else
+static int __arena_option = 0;
+#endif
 static size_t __arena_size = (2 * _Mib_);
 static size_t __arena_chunk_size_limit = (16 * _Kib_);
 static llhead_t __arenas;
+static bbtree_t __arenas_tree;
+static splock_t __arenas_lock;
 static heap_arena_t __firstArena;
+static heap_tcache_t __tcaches[HEAP_TCACHE_CPUS];
 
 static heap_arena_t *new_arena(size_t length)
 {
-    ++__empty_arena;
     heap_arena_t *arena = (heap_arena_t *)_PRT(malloc)(sizeof(heap_arena_t));
     void *map = mmap(length);
     assert(map != NULL && map != (void *) - 1);
     setup_arena(arena, (size_t)map, length, __arena_chunk_size_limit,
                 __arena_option);
+    arena->bnode_.value_ = arena->address_;
+    splock_lock(&__arenas_lock);
+    ++__empty_arena;
     ll_append(&__arenas, &arena->node_);
+    bbtree_insert(&__arenas_tree, &arena->bnode_);
+    splock_unlock(&__arenas_lock);
     return arena;
 }
 
+/* Arenas are indexed by address, mapped blocks included */
 static heap_arena_t *find_arena(size_t ptr)
 {
-    heap_arena_t *arena;
-    // printf(" FREE - Look for 0x%zx\n", ptr);
-    for ll_each(&__arenas, arena, heap_arena_t, node_) {
-        // printf("   |-> Arean 0x%zx - 0x%zx\n", arena->address_, arena->address_ + arena->length_);
-        if (arena->address_ > ptr || arena->address_ + arena->length_ <= ptr)
-            continue;
-        return arena;
+    splock_lock(&__arenas_lock);
+    heap_arena_t *arena = bbtree_search_le(&__arenas_tree, ptr, heap_arena_t, bnode_);
+    splock_unlock(&__arenas_lock);
+    if (arena == NULL || arena->address_ + arena->length_ <= ptr)
+        return NULL;
+    return arena;
+}
+
+/* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
+
+static void tcache_release(void *ptr)
+{
+    while (ptr != NULL) {
+        void *next = *(void **)ptr;
+        heap_arena_t *arena = find_arena((size_t)ptr);
+        assert(arena != NULL);
+        free_r(arena, ptr);
+        ptr = next;
+    }
+}
+
+static void *tcache_pop(size_t size)
+{
+    size_t bin = msize_fit_r(size) / 8;
+    if (bin >= HEAP_TCACHE_BINS)
+        return NULL;
+    heap_tcache_t *tc = &__tcaches[cpu_no() % HEAP_TCACHE_CPUS];
+    splock_lock(&tc->lock);
+    void *ptr = tc->bins[bin];
+    if (ptr != NULL) {
+        tc->bins[bin] = *(void **)ptr;
+        tc->count[bin]--;
     }
-    return NULL;
+    splock_unlock(&tc->lock);
+    return ptr;
 }
 
+static bool tcache_push(void *ptr)
+{
+    size_t bin = msize_r(ptr) / 8;
+    if (bin >= HEAP_TCACHE_BINS)
+        return false;
+    void *batch = NULL;
+    heap_tcache_t *tc = &__tcaches[cpu_no() % HEAP_TCACHE_CPUS];
+    splock_lock(&tc->lock);
+    if (tc->count[bin] == HEAP_TCACHE_COUNT) {
+        /* Detach half of the bin, to be given back to the arenas */
+        void **last = tc->bins[bin];
+        for (int i = 1; i < HEAP_TCACHE_COUNT / 2; ++i)
+            last = *last;
+        batch = tc->bins[bin];
+        tc->bins[bin] = *last;
+        *last = NULL;
+        tc->count[bin] -= HEAP_TCACHE_COUNT / 2;
+    }
+    *(void **)ptr = tc->bins[bin];
+    tc->bins[bin] = ptr;
+    tc->count[bin]++;
+    splock_unlock(&tc->lock);
+    tcache_release(batch);
+    return true;
+}
+
+static void tcache_flush(heap_tcache_t *tc)
+{
+    for (int bin = 0; bin < HEAP_TCACHE_BINS; ++bin) {
+        splock_lock(&tc->lock);
+        void *batch = tc->bins[bin];
+        tc->bins[bin] = NULL;
+        tc->count[bin] = 0;
+        splock_unlock(&tc->lock);
+        tcache_release(batch);
+    }
+}
+
+/* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
+
 /* Dynamicaly allocate a page align memory block */
 void *_PRT(valloc)(size_t size)
 {
     heap_arena_t *arena = (heap_arena_t *)_PRT(malloc)(sizeof(heap_arena_t));
     size = ALIGN_UP(size, PAGE_SIZE);
     void *map = mmap(size);
-    assert(map != NULL && map == (void *) - 1);
+    assert(map != NULL && map != (void *) - 1);
+    memset(arena, 0, sizeof(heap_arena_t));
     arena->address_ = (size_t)map;
     arena->length_ = size;
     arena->flags_ = HEAP_MAPPED;
-    ll_append(&__arenas, &arena->node_);
-    /* TODO CREATE ARENA(HEAP_MAPPED) PUSH ON BBTREE */
+    arena->bnode_.value_ = arena->address_;
+    splock_lock(&__arenas_lock);
+    bbtree_insert(&__arenas_tree, &arena->bnode_);
+    splock_unlock(&__arenas_lock);
     return map;
 }
 
@@ -92,6 +185,11 @@ void *_PRT(malloc)(size_t size)
     if (size > __arena_chunk_size_limit)
         return _PRT(valloc)(size);
 
+    ptr = tcache_pop(size);
+    if (ptr != NULL)
+        return ptr;
+
+    splock_lock(&__arenas_lock);
     for ll_each(&__arenas, arena, heap_arena_t, node_) {
         if (arena->length_ - arena->used_ < size)
             continue;
@@ -103,6 +201,8 @@ void *_PRT(malloc)(size_t size)
         if (ptr != NULL)
             break;
     }
+    bool spare = __empty_arena <= 0;
+    splock_unlock(&__arenas_lock);
 
     if (ptr == NULL) {
         arena = new_arena(__arena_size);
@@ -110,10 +210,12 @@ void *_PRT(malloc)(size_t size)
         ptr = malloc_r(arena, size);
     }
 
-    if (__empty_arena == 0) {
+    if (spare) {
         arena = new_arena(__arena_size);
         assert(arena != NULL);
+        splock_lock(&__arenas_lock);
         __empty_arena++;
+        splock_unlock(&__arenas_lock);
     }
 
     return ptr;
@@ -135,11 +237,22 @@ void *_PRT(calloc)(size_t nmemb, size_t size)
 /* Re-allocate a block memory */
 void *_PRT(realloc)(void *ptr, size_t size)
 {
-    size_t lg = 0; /* Get chunk size */
+    size_t lg;
     void *buf;
-    if (lg > size)
-        return ptr;
-    /* TODO try to grab next item! */
+    if (ptr == NULL)
+        return _PRT(malloc)(size);
+    heap_arena_t *arena = find_arena((size_t)ptr);
+    assert(arena != NULL);
+    if (arena->flags_ & HEAP_MAPPED) {
+        lg = arena->length_;
+        if (lg >= size)
+            return ptr;
+    } else {
+        /* Try to resize using the next chunk */
+        if (realloc_r(arena, ptr, size) != NULL)
+            return ptr;
+        lg = msize_r(ptr);
+    }
     buf = _PRT(malloc)(size);
     memcpy(buf, ptr, MIN(lg, size));
     _PRT(free)(ptr);
@@ -150,14 +263,17 @@ void *_PRT(realloc)(void *ptr, size_t size)
 void _PRT(free)(void *ptr)
 {
     assert(ptr != NULL);
-    heap_arena_t *arena = find_arena((size_t)ptr); /* TODO bbtree GET */
+    heap_arena_t *arena = find_arena((size_t)ptr);
     assert(arena != NULL);
     if (arena->flags_ & HEAP_MAPPED) {
         assert((size_t)ptr == arena->address_);
         unmap((void *)arena->address_, arena->length_);
-        /* Remove from bbtree and free */
+        splock_lock(&__arenas_lock);
+        bbtree_remove(&__arenas_tree, arena->address_);
+        splock_unlock(&__arenas_lock);
+        _PRT(free)(arena);
         // } else if ((size_t)ptr >= arena->address_ && (size_t)ptr < arena->address_ + arena->length_) {
-    } else {
+    } else if (!tcache_push(ptr)) {
         free_r(arena, ptr);
         // __FAIL(-1, ""); /* TODO */
     }
@@ -169,22 +285,35 @@ void setup_allocator(void *base, size_t len)
     __empty_arena = 0;
     memset(&__arenas, 0, sizeof(__arenas));
     memset(&__firstArena, 0, sizeof(__firstArena));
+    memset(__tcaches, 0, sizeof(__tcaches));
+    bbtree_init(&__arenas_tree);
+    splock_init(&__arenas_lock);
     setup_arena(&__firstArena, (size_t)base, len, __arena_chunk_size_limit,
                 __arena_option);
     ll_append(&__arenas, &__firstArena.node_);
+    __firstArena.bnode_.value_ = __firstArena.address_;
+    bbtree_insert(&__arenas_tree, &__firstArena.bnode_);
     __empty_arena = 1;
 }
 
 void sweep_allocator()
 {
+    for (int i = 0; i < HEAP_TCACHE_CPUS; ++i)
+        tcache_flush(&__tcaches[i]);
+
+    splock_lock(&__arenas_lock);
     heap_arena_t *arena = ll_first(&__arenas, heap_arena_t, node_);
     while (arena) {
         heap_arena_t *next = ll_next(&arena->node_, heap_arena_t, node_);
         if (arena->used_ == 0 && arena != &__firstArena) {
+            ll_remove(&__arenas, &arena->node_);
+            bbtree_remove(&__arenas_tree, arena->address_);
+            splock_unlock(&__arenas_lock);
             unmap((void *)arena->address_, arena->length_);
             _PRT(free)(arena);
-            ll_remove(&__arenas, &arena->node_);
+            splock_lock(&__arenas_lock);
         }
         arena = next;
     }
+    splock_unlock(&__arenas_lock);
 }
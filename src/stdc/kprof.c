@@ -0,0 +1,213 @@
+/*
+ *      This file is part of the KoraOS project.
+ *  Copyright (C) 2015-2021  <Fabien Bavent>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   - - - - - - - - - - - - - - -
+ */
+#include <kernel/kprof.h>
+#include <kora/bbtree.h>
+#include <kora/llist.h>
+#include <kora/splock.h>
+#include <bits/atomic.h>
+#include <stdlib.h>
+
+typedef struct kprof_site kprof_site_t;
+typedef struct kprof_block kprof_block_t;
+
+/* Counters of an allocation site, as seen by the samples */
+struct kprof_site {
+    const char *expr;
+    long allocs;
+    long frees;
+    size_t live;
+    size_t peak;
+    bbnode_t bnode;
+    llnode_t lnode;
+};
+
+/* Sampled block, still alive */
+struct kprof_block {
+    size_t len;
+    kprof_site_t *site;
+    bbnode_t bnode;
+};
+
+/* Records are taken from malloc as kalloc is the very thing we observe */
+splock_t kprof_lock = INIT_SPLOCK;
+bbtree_t kprof_sites;
+bbtree_t kprof_blocks;
+llhead_t kprof_list = INIT_LLHEAD;
+atomic_int kprof_tick;
+#ifdef KALLOC_PROFILE
+int kprof_rate = KPROF_RATE;
+#else
+int kprof_rate = 0;
+#endif
+int kprof_count = 0;
+bool kprof_ready = false;
+
+static void kprof_clear()
+{
+    if (!kprof_ready) {
+        bbtree_init(&kprof_sites);
+        bbtree_init(&kprof_blocks);
+        kprof_ready = true;
+    }
+    while (kprof_blocks.count_ > 0) {
+        kprof_block_t *block = bbtree_first(&kprof_blocks, kprof_block_t, bnode);
+        bbtree_remove(&kprof_blocks, block->bnode.value_);
+        free(block);
+    }
+    while (kprof_sites.count_ > 0) {
+        kprof_site_t *site = bbtree_first(&kprof_sites, kprof_site_t, bnode);
+        bbtree_remove(&kprof_sites, site->bnode.value_);
+        ll_remove(&kprof_list, &site->lnode);
+        free(site);
+    }
+    kprof_count = 0;
+}
+
+/* Change the sampling period and reset the counters, zero stops profiling */
+void kprof_setup(int rate)
+{
+    splock_lock(&kprof_lock);
+    kprof_clear();
+    kprof_rate = rate > 0 ? rate : 0;
+    atomic_store(&kprof_tick, 0);
+    splock_unlock(&kprof_lock);
+}
+
+void kprof_alloc(void *ptr, size_t len, const char *expr)
+{
+    int rate = kprof_rate;
+    if (rate == 0 || ptr == NULL || atomic_xadd(&kprof_tick, 1) % rate != 0)
+        return;
+
+    // malloc might need a new arena and come back here, records are never
+    // allocated while holding the lock
+    kprof_block_t *block = malloc(sizeof(kprof_block_t));
+    if (block == NULL)
+        return;
+    kprof_site_t *site = NULL;
+    kprof_site_t *spare = NULL;
+    splock_lock(&kprof_lock);
+    for (;;) {
+        if (kprof_rate == 0) {
+            splock_unlock(&kprof_lock);
+            free(block);
+            if (spare != NULL)
+                free(spare);
+            return;
+        }
+        if (!kprof_ready)
+            kprof_clear();
+        site = bbtree_search_eq(&kprof_sites, (size_t)expr, kprof_site_t, bnode);
+        if (site != NULL || spare != NULL)
+            break;
+        splock_unlock(&kprof_lock);
+        spare = malloc(sizeof(kprof_site_t));
+        if (spare == NULL) {
+            free(block);
+            return;
+        }
+        splock_lock(&kprof_lock);
+    }
+
+    if (site == NULL) {
+        site = spare;
+        spare = NULL;
+        memset(site, 0, sizeof(kprof_site_t));
+        site->expr = expr;
+        site->bnode.value_ = (size_t)expr;
+        bbtree_insert(&kprof_sites, &site->bnode);
+        ll_append(&kprof_list, &site->lnode);
+    }
+
+    block->len = len;
+    block->site = site;
+    block->bnode.value_ = (size_t)ptr;
+    bbtree_insert(&kprof_blocks, &block->bnode);
+    kprof_count++;
+    site->allocs++;
+    site->live += len;
+    if (site->live > site->peak)
+        site->peak = site->live;
+    splock_unlock(&kprof_lock);
+    if (spare != NULL)
+        free(spare);
+}
+
+void kprof_free(void *ptr)
+{
+    // Nothing is sampled, avoid the lock
+    if (kprof_count == 0)
+        return;
+
+    splock_lock(&kprof_lock);
+    kprof_block_t *block = bbtree_search_eq(&kprof_blocks, (size_t)ptr, kprof_block_t, bnode);
+    if (block == NULL) {
+        splock_unlock(&kprof_lock);
+        return;
+    }
+    bbtree_remove(&kprof_blocks, (size_t)ptr);
+    kprof_count--;
+    block->site->frees++;
+    block->site->live -= block->len;
+    splock_unlock(&kprof_lock);
+    free(block);
+}
+
+/* Sites holding the most memory come first */
+static int kprof_compare(kprof_site_t *a, kprof_site_t *b)
+{
+    if (a->live != b->live)
+        return a->live < b->live ? 1 : -1;
+    if (a->allocs != b->allocs)
+        return a->allocs < b->allocs ? 1 : -1;
+    return 0;
+}
+
+/* Write the table of allocation sites, figures are scaled by the sampling period */
+int kprof_report(char *buf, size_t len)
+{
+    kprof_site_t *site;
+    size_t pos = 0;
+    splock_lock(&kprof_lock);
+    long rate = kprof_rate > 0 ? kprof_rate : 1;
+    int ret = snprintf(buf, len, "Heap profile, 1/%d sampled\n%8s %8s %10s %10s  %s\n",
+                       kprof_rate, "allocs", "frees", "live", "peak", "site");
+    if (ret < 0 || (size_t)ret >= len) {
+        splock_unlock(&kprof_lock);
+        return 0;
+    }
+    pos += ret;
+    llist_sort(&kprof_list, offsetof(kprof_site_t, lnode), (void *)kprof_compare);
+    for ll_each(&kprof_list, site, kprof_site_t, lnode) {
+        ret = snprintf(&buf[pos], len - pos, "%8ld %8ld %10ld %10ld  %s\n",
+                       site->allocs * rate, site->frees * rate,
+                       (long)site->live * rate, (long)site->peak * rate, site->expr);
+        if (ret < 0 || (size_t)ret >= len - pos) {
+            buf[pos] = '\0';
+            break;
+        }
+        pos += ret;
+    }
+    splock_unlock(&kprof_lock);
+    return pos;
+}
+
+EXPORT_SYMBOL(kprof_setup, 0);
+EXPORT_SYMBOL(kprof_report, 0);
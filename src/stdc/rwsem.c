@@ -0,0 +1,99 @@
+/*
+ *      This file is part of the KoraOS project.
+ *  Copyright (C) 2015-2021  <Fabien Bavent>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   - - - - - - - - - - - - - - -
+ */
+#include <threads.h>
+#include <sys/rwsem.h>
+#include <assert.h>
+#include <kernel/mods.h>
+
+int rwsem_init(rwsem_t *sem)
+{
+    if (sem == NULL)
+        return thrd_error;
+
+    sem->readers = 0;
+    sem->writers = 0;
+    sem->locked = false;
+    int res = mtx_init(&sem->mtx, mtx_plain);
+    if (res == thrd_success)
+        res = cnd_init(&sem->cv);
+    return res;
+}
+
+void rwsem_destroy(rwsem_t *sem)
+{
+    assert(sem != NULL && sem->readers == 0 && sem->writers == 0);
+    mtx_destroy(&sem->mtx);
+    cnd_destroy(&sem->cv);
+}
+
+void rwsem_rdlock(rwsem_t *sem)
+{
+    assert(sem != NULL);
+    mtx_lock(&sem->mtx);
+    while (sem->writers != 0)
+        cnd_wait(&sem->cv, &sem->mtx);
+    ++sem->readers;
+    mtx_unlock(&sem->mtx);
+}
+
+void rwsem_rdunlock(rwsem_t *sem)
+{
+    assert(sem != NULL);
+    mtx_lock(&sem->mtx);
+    assert(sem->readers > 0);
+    if (--sem->readers == 0 && sem->writers != 0)
+        cnd_broadcast(&sem->cv);
+    mtx_unlock(&sem->mtx);
+}
+
+void rwsem_wrlock(rwsem_t *sem)
+{
+    assert(sem != NULL);
+    mtx_lock(&sem->mtx);
+    ++sem->writers;
+    while (sem->readers != 0 || sem->locked)
+        cnd_wait(&sem->cv, &sem->mtx);
+    sem->locked = true;
+    mtx_unlock(&sem->mtx);
+}
+
+void rwsem_wrunlock(rwsem_t *sem)
+{
+    assert(sem != NULL);
+    mtx_lock(&sem->mtx);
+    assert(sem->locked);
+    sem->locked = false;
+    --sem->writers;
+    cnd_broadcast(&sem->cv);
+    mtx_unlock(&sem->mtx);
+}
+
+bool rwsem_wrlocked(rwsem_t *sem)
+{
+    return sem->locked;
+}
+
+EXPORT_SYMBOL(rwsem_init, 0);
+EXPORT_SYMBOL(rwsem_destroy, 0);
+EXPORT_SYMBOL(rwsem_rdlock, 0);
+EXPORT_SYMBOL(rwsem_rdunlock, 0);
+EXPORT_SYMBOL(rwsem_wrlock, 0);
+EXPORT_SYMBOL(rwsem_wrunlock, 0);
+EXPORT_SYMBOL(rwsem_wrlocked, 0);
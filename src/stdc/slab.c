@@ -0,0 +1,327 @@
+/*
+ *      This file is part of the KoraOS project.
+ *  Copyright (C) 2015-2021  <Fabien Bavent>
+ *
+ *  This program is free software: you can redistribute it and/or modify
+ *  it under the terms of the GNU Affero General Public License as
+ *  published by the Free Software Foundation, either version 3 of the
+ *  License, or (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU Affero General Public License for more details.
+ *
+ *  You should have received a copy of the GNU Affero General Public License
+ *  along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ *   - - - - - - - - - - - - - - -
+ */
+#include <kernel/slab.h>
+#include <assert.h>
+#ifdef KORA_KRN
+#include <kernel/memory.h>
+#else
+#include <stdlib.h>
+#endif
+
+int cpu_no();
+
+#define KMEM_ALIGN  (sizeof(void *))
+#define KMEM_ALIGN_UP(v)  (((v) + KMEM_ALIGN - 1) & ~(KMEM_ALIGN - 1))
+
+typedef struct kmem_slab kmem_slab_t;
+
+/* Header of a slab, objects follow it on the same page */
+struct kmem_slab {
+    llnode_t lnode;
+    kmem_cache_t *cache;
+    size_t page;
+    void *free;
+    int inuse;
+};
+
+#define KMEM_OFFSET  KMEM_ALIGN_UP(sizeof(kmem_slab_t))
+#define KMEM_LINK(c,o)  (*(void **)((char *)(o) + (c)->link))
+/* Slabs are page aligned, the header of an object is on its page start */
+#define KMEM_SLAB(o)  ((kmem_slab_t *)((size_t)(o) & ~(PAGE_SIZE - 1)))
+
+static llhead_t kmem_caches = INIT_LLHEAD;
+static splock_t kmem_lock = INIT_SPLOCK;
+
+
+/* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
+
+#ifdef KORA_KRN
+/* Take a page of the page allocator, mapped on the kernel space */
+static kmem_slab_t *kmem_slab_new()
+{
+    size_t page = page_new();
+    if (page == 0)
+        return NULL;
+    kmem_slab_t *slab = kmap(PAGE_SIZE, NULL, page, VMA_PHYS | VM_RW);
+    slab->page = page;
+    return slab;
+}
+
+static void kmem_slab_release(kmem_slab_t *slab)
+{
+    size_t page = slab->page;
+    kunmap(slab, PAGE_SIZE);
+    page_release(page);
+}
+#else
+/* Host builds have no physical pages, aligned blocks stand for them */
+static kmem_slab_t *kmem_slab_new()
+{
+    kmem_slab_t *slab = aligned_alloc(PAGE_SIZE, PAGE_SIZE);
+    if (slab != NULL)
+        slab->page = 0;
+    return slab;
+}
+
+static void kmem_slab_release(kmem_slab_t *slab)
+{
+    free(slab);
+}
+#endif
+
+static void kmem_cache_setup(kmem_cache_t *cache)
+{
+    splock_lock(&kmem_lock);
+    splock_lock(&cache->lock);
+    if (!cache->ready) {
+        // Without constructor the free link lives inside the object,
+        // otherwise it is kept after it to preserve the constructed state.
+        size_t size = KMEM_ALIGN_UP(cache->size);
+        if (size < KMEM_ALIGN)
+            size = KMEM_ALIGN;
+        cache->link = cache->ctor ? size : 0;
+        cache->stride = cache->ctor ? size + KMEM_ALIGN : size;
+        cache->per_slab = (PAGE_SIZE - KMEM_OFFSET) / cache->stride;
+        assert(cache->per_slab > 0);
+        ll_append(&kmem_caches, &cache->node);
+        cache->ready = true;
+    }
+    splock_unlock(&cache->lock);
+    splock_unlock(&kmem_lock);
+}
+
+/* Allocate and populate a new slab */
+static int kmem_grow(kmem_cache_t *cache)
+{
+    kmem_slab_t *slab = kmem_slab_new();
+    if (slab == NULL)
+        return -1;
+    slab->cache = cache;
+    slab->inuse = 0;
+    slab->free = NULL;
+    char *base = (char *)slab + KMEM_OFFSET;
+    for (int i = cache->per_slab; i-- > 0; ) {
+        void *obj = base + i * cache->stride;
+        if (cache->ctor)
+            cache->ctor(obj);
+        KMEM_LINK(cache, obj) = slab->free;
+        slab->free = obj;
+    }
+
+    splock_lock(&cache->lock);
+    ll_append(&cache->partial, &slab->lnode);
+    cache->slabs++;
+    cache->empties++;
+    splock_unlock(&cache->lock);
+    return 0;
+}
+
+/* Take an object from the first slab having free room, lock held */
+static void *kmem_take(kmem_cache_t *cache)
+{
+    kmem_slab_t *slab = ll_first(&cache->partial, kmem_slab_t, lnode);
+    if (slab == NULL)
+        return NULL;
+    void *obj = slab->free;
+    slab->free = KMEM_LINK(cache, obj);
+    if (slab->inuse++ == 0)
+        cache->empties--;
+    if (slab->free == NULL)
+        ll_remove(&cache->partial, &slab->lnode);
+    cache->inuse++;
+    return obj;
+}
+
+/* Give an object back to its slab, lock held. Slabs found empty beyond a
+ * spare one are unlinked and pushed on `dead' to be freed once unlocked. */
+static void kmem_give(kmem_cache_t *cache, void *obj, llhead_t *dead)
+{
+    kmem_slab_t *slab = KMEM_SLAB(obj);
+    assert(slab->cache == cache);
+    if (slab->free == NULL)
+        ll_enqueue(&cache->partial, &slab->lnode);
+    KMEM_LINK(cache, obj) = slab->free;
+    slab->free = obj;
+    cache->inuse--;
+    if (--slab->inuse != 0)
+        return;
+
+    ll_remove(&cache->partial, &slab->lnode);
+    if (cache->empties == 0) {
+        // Keep one spare slab, at the end to be used last
+        ll_append(&cache->partial, &slab->lnode);
+        cache->empties++;
+        return;
+    }
+    cache->slabs--;
+    ll_append(dead, &slab->lnode);
+}
+
+static void kmem_release(llhead_t *dead)
+{
+    kmem_slab_t *slab;
+    while ((slab = ll_take(dead, kmem_slab_t, lnode)) != NULL)
+        kmem_slab_release(slab);
+}
+
+/* Move objects from the slabs into the magazine, magazine lock held */
+static void kmem_refill(kmem_cache_t *cache, kmem_magazine_t *mag)
+{
+    splock_lock(&cache->lock);
+    while (mag->count < KMEM_MAGAZINE / 2) {
+        void *obj = kmem_take(cache);
+        if (obj == NULL)
+            break;
+        mag->objs[mag->count++] = obj;
+    }
+    splock_unlock(&cache->lock);
+}
+
+/* Move objects from the magazine back to the slabs, magazine lock held */
+static void kmem_drain(kmem_cache_t *cache, kmem_magazine_t *mag, int count, llhead_t *dead)
+{
+    splock_lock(&cache->lock);
+    while (count-- > 0 && mag->count > 0)
+        kmem_give(cache, mag->objs[--mag->count], dead);
+    splock_unlock(&cache->lock);
+}
+
+
+/* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
+
+kmem_cache_t *kmem_cache_create(const char *name, size_t size, kmem_ctor_t ctor)
+{
+    kmem_cache_t *cache = kalloc(sizeof(kmem_cache_t));
+    memset(cache, 0, sizeof(kmem_cache_t));
+    cache->name = name;
+    cache->size = size;
+    cache->ctor = ctor;
+    cache->dynamic = true;
+    kmem_cache_setup(cache);
+    return cache;
+}
+
+void kmem_cache_destroy(kmem_cache_t *cache)
+{
+    if (!cache->ready)
+        return;
+    kmem_cache_shrink(cache);
+    assert(cache->inuse == 0 && cache->slabs == 0);
+    splock_lock(&kmem_lock);
+    ll_remove(&kmem_caches, &cache->node);
+    cache->ready = false;
+    splock_unlock(&kmem_lock);
+    if (cache->dynamic)
+        kfree(cache);
+}
+
+void *kmem_cache_alloc(kmem_cache_t *cache)
+{
+    if (!cache->ready)
+        kmem_cache_setup(cache);
+    kmem_magazine_t *mag = &cache->mags[cpu_no() % KMEM_CPUS];
+    for (;;) {
+        splock_lock(&mag->lock);
+        if (mag->count == 0)
+            kmem_refill(cache, mag);
+        void *obj = mag->count > 0 ? mag->objs[--mag->count] : NULL;
+        splock_unlock(&mag->lock);
+        if (obj != NULL) {
+            if (cache->ctor == NULL && !(cache->flags & KMEM_NOZERO))
+                memset(obj, 0, cache->size);
+            return obj;
+        }
+        if (kmem_grow(cache) != 0)
+            return NULL;
+    }
+}
+
+void kmem_cache_free(kmem_cache_t *cache, void *ptr)
+{
+    if (ptr == NULL)
+        return;
+    assert(cache->ready);
+    llhead_t dead = INIT_LLHEAD;
+    kmem_magazine_t *mag = &cache->mags[cpu_no() % KMEM_CPUS];
+    splock_lock(&mag->lock);
+    if (mag->count == KMEM_MAGAZINE)
+        kmem_drain(cache, mag, KMEM_MAGAZINE / 2, &dead);
+    mag->objs[mag->count++] = ptr;
+    splock_unlock(&mag->lock);
+    kmem_release(&dead);
+}
+
+/* Flush every magazine and free all empty slabs, return the slab count */
+int kmem_cache_shrink(kmem_cache_t *cache)
+{
+    if (!cache->ready)
+        return 0;
+    llhead_t dead = INIT_LLHEAD;
+    for (int i = 0; i < KMEM_CPUS; ++i) {
+        kmem_magazine_t *mag = &cache->mags[i];
+        splock_lock(&mag->lock);
+        kmem_drain(cache, mag, KMEM_MAGAZINE, &dead);
+        splock_unlock(&mag->lock);
+    }
+
+    splock_lock(&cache->lock);
+    kmem_slab_t *slab = ll_last(&cache->partial, kmem_slab_t, lnode);
+    while (slab != NULL && slab->inuse == 0) {
+        kmem_slab_t *prev = ll_previous(&slab->lnode, kmem_slab_t, lnode);
+        ll_remove(&cache->partial, &slab->lnode);
+        cache->slabs--;
+        cache->empties--;
+        ll_append(&dead, &slab->lnode);
+        slab = prev;
+    }
+    splock_unlock(&cache->lock);
+
+    int count = dead.count_;
+    kmem_release(&dead);
+    return count;
+}
+
+/* Shrink all caches. Caches are only removed at teardown, so the list is
+ * walked without holding its lock while slabs are released. */
+int kmem_sweep()
+{
+    int count = 0;
+    splock_lock(&kmem_lock);
+    kmem_cache_t *cache = ll_first(&kmem_caches, kmem_cache_t, node);
+    splock_unlock(&kmem_lock);
+    while (cache) {
+        count += kmem_cache_shrink(cache);
+        splock_lock(&kmem_lock);
+        cache = ll_next(&cache->node, kmem_cache_t, node);
+        splock_unlock(&kmem_lock);
+    }
+    return count;
+}
+
+void kmem_info()
+{
+    kmem_cache_t *cache;
+    splock_lock(&kmem_lock);
+    for ll_each(&kmem_caches, cache, kmem_cache_t, node) {
+        kprintf(KL_DBG, "  %-12s  %4d B  %6d objs  %4d slabs (%d empty)\n", cache->name,
+                (int)cache->size, cache->inuse, cache->slabs, cache->empties);
+    }
+    splock_unlock(&kmem_lock);
+}
@@ -27,6 +27,7 @@
 #include <kernel/tasks.h>
 #include <kernel/input.h>
 #include <kernel/irq.h>
+#include <kernel/slab.h>
 
 typedef struct ftx ftx_t;
 
@@ -114,7 +115,7 @@ static ftx_t *futex_open(masterclock_t *clock, int *addr, int flags)
     splock_lock(&clock->tree_lock);
     ftx_t *futex = bbtree_search_eq(&clock->tree, phys, ftx_t, bnode);
     if (futex == NULL && (flags & FUTEX_CREATE)) {
-        futex = (ftx_t *)kalloc(sizeof(ftx_t));
+        futex = (ftx_t *)kzalloc(sizeof(ftx_t));
         memset(futex, 0, sizeof(ftx_t));
         futex->flags = flags;
         if (flags & FUTEX_SHARED) {
@@ -242,6 +243,8 @@ int futex_wake(int *addr, int val, int flags)
 
 /* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
 
+static kmem_cache_t advent_cache = INIT_KMEM_CACHE("advent", advent_t, NULL);
+
 static void itimer_wake_advent(masterclock_t *clock, advent_t *advent)
 {
     evmsg_t msg;
@@ -254,12 +257,12 @@ static void itimer_wake_advent(masterclock_t *clock, advent_t *advent)
 static void itimer_dtor_advent(masterclock_t *clock, advent_t *advent)
 {
     advent_unregister(clock, advent);
-    kfree(advent);
+    kmem_cache_free(&advent_cache, advent);
 }
 
 void itimer_create(inode_t *ino, long delay, long interval)
 {
-    advent_t *advent = kalloc(sizeof(advent_t));
+    advent_t *advent = kmem_cache_alloc(&advent_cache);
     advent->object = ino;
     advent->wake = itimer_wake_advent;
     advent->dtor = itimer_dtor_advent;
@@ -290,7 +293,7 @@ void clock_handler();
 
 masterclock_t *clock_init(xtime_t now)
 {
-    // masterclock_t*clock = kalloc(sizeof(masterclock_t));
+    // masterclock_t*clock = kzalloc(sizeof(masterclock_t));
     splock_init(&__clock.lock);
     splock_init(&__clock.tree_lock);
     bbtree_init(&__clock.tree);
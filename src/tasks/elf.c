@@ -190,7 +190,7 @@ void elf_requires(dynlib_t *dlib, elf_phead_t *ph, const char *strtab)
         if (dyen[i * 2] != 1)
             continue;
         int idx = dyen[i * 2 + 1];
-        dyndep_t *dep = kalloc(sizeof(dyndep_t));
+        dyndep_t *dep = kzalloc(sizeof(dyndep_t));
         dep->name = strdup(&strtab[idx]);
         // kprintf(-1, "Rq:  %s \n", dep->name);
         ll_append(&dlib->depends, &dep->node);
@@ -254,7 +254,7 @@ int elf_parse(dynlib_t *dlib)
     elf_phead_t *ph_tbl = ADDR_OFF(head, head->ph_off);
     for (i = 0; i < head->ph_count; ++i) {
         if (ph_tbl[i].type == ELF_PH_LOAD) {
-            dynsec_t *section = kalloc(sizeof(dynsec_t));
+            dynsec_t *section = kzalloc(sizeof(dynsec_t));
             ll_append(&dlib->sections, &section->node);
             elf_section(&ph_tbl[i], section);
             if (dlib->base > section->lower + section->offset)
@@ -310,7 +310,7 @@ int elf_parse(dynlib_t *dlib)
     unsigned sym_count = hash[1];
     // kprintf(-1, "ELF DYN HASH [%08x, %08x, %08x, %08x]\n", hash[0], hash[1], hash[2], hash[3]);
     for (i = 1; i < sym_count; ++i) {
-        dynsym_t *sym = kalloc(sizeof(dynsym_t));
+        dynsym_t *sym = kzalloc(sizeof(dynsym_t));
         ll_append(&symbols, &sym->node);
         elf_symbol(sym, &sym_tbl[i], dlib, &dynamic, strtab);
     }
@@ -336,7 +336,7 @@ int elf_parse(dynlib_t *dlib)
         int rel_type = rel_tbl[i * ent_sz + 1] & 0xF;
         if (rel_type == 0)
             break;
-        dynrel_t *rel = kalloc(sizeof(dynrel_t));
+        dynrel_t *rel = kzalloc(sizeof(dynrel_t));
         elf_relocation(rel, &rel_tbl[i * ent_sz], &symbols);
         if (rel->address == 0) {
             kfree(rel);
@@ -22,6 +22,7 @@
 #include <kora/splock.h>
 #include <kora/bbtree.h>
 #include <kernel/tasks.h>
+#include <kernel/slab.h>
 #include <errno.h>
 
 struct streamset {
@@ -39,12 +40,14 @@ struct fstream
     void(*close)(void *);
 };
 
+static kmem_cache_t resx_cache = INIT_KMEM_CACHE("resx", resx_t, NULL);
+
 /* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
 
 
 int resx_put(streamset_t *strms, int type, void *data, void(*close)(void *))
 {
-    resx_t *resx = kalloc(sizeof(resx_t));
+    resx_t *resx = kmem_cache_alloc(&resx_cache);
     splock_lock(&strms->lock);
     resx_t *p = bbtree_last(&strms->tree, resx_t, node);
     size_t handle = p == NULL ? 0 : p->node.value_ + 1;
@@ -76,7 +79,7 @@ void resx_remove(streamset_t *strms, int handle)
             resx->close(resx->data);
             splock_lock(&strms->lock);
         }
-        kfree(resx);
+        kmem_cache_free(&resx_cache, resx);
     }
     splock_unlock(&strms->lock);
 }
@@ -85,7 +88,7 @@ void resx_remove(streamset_t *strms, int handle)
 
 streamset_t *stream_create_set()
 {
-    streamset_t *strms = kalloc(sizeof(streamset_t));
+    streamset_t *strms = kzalloc(sizeof(streamset_t));
     splock_init(&strms->lock);
     bbtree_init(&strms->tree);
     strms->rcu = 1;
@@ -105,9 +108,10 @@ void stream_close_set(streamset_t *strms)
 
     while (strms->tree.count_ > 0) {
         resx_t *resx = bbtree_first(&strms->tree, resx_t, node);
+        bbtree_remove(&strms->tree, resx->node.value_);
         if (resx->close)
             resx->close(resx->data);
-        kfree(resx);
+        kmem_cache_free(&resx_cache, resx);
     }
     kfree(strms);
 }
@@ -116,7 +120,7 @@ void stream_close_set(streamset_t *strms)
 
 file_t *file_from_inode(inode_t *ino, int flags)
 {
-    file_t *file = kalloc(sizeof(file_t));
+    file_t *file = kzalloc(sizeof(file_t));
     file->ino = vfs_open_inode(ino);
     file->off = 0;
     file->oflags = flags & (VM_RW);
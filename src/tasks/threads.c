@@ -62,7 +62,7 @@ _Noreturn void task_usermode(task_params_t *info)
 static task_t *task_create(scheduler_t *sch, task_t *parent, const char *name, int flags)
 {
     // Allocate
-    task_t *task = kalloc(sizeof(task_t));
+    task_t *task = kzalloc(sizeof(task_t));
     task->stack = kmap(KSTACK_PAGES * PAGE_SIZE, NULL, 0, VM_RW | VM_RESOLVE | VMA_STACK);
     task->status = TS_ZOMBIE;
     task->parent = parent;
@@ -143,7 +143,7 @@ size_t task_spawn(const char *program, const char **args, inode_t **nodes)
     }
 
     // Save args
-    task_params_t *info = kalloc(sizeof(task_params_t));
+    task_params_t *info = kzalloc(sizeof(task_params_t));
     info->start = true;
     info->func = task->vmsp->proc->exec->entry; // TODO -- Create accessor
     int i, count = 1;
@@ -157,7 +157,7 @@ size_t task_spawn(const char *program, const char **args, inode_t **nodes)
 
     len += sizeof(void *) * (count + 3);
     info->len = len;
-    info->params = kalloc(len);
+    info->params = kzalloc(len);
     info->params[0] = count;
     info->params[1] = 0; // &info->params[4];
     info->params[2] = 0; // environ
@@ -186,10 +186,10 @@ size_t task_thread(const char *name, void *entry, void *params, size_t len, int
     task_t *task = task_create(&__scheduler, __current, name, flags);
 
     // Save args
-    task_params_t *info = kalloc(sizeof(task_params_t));
+    task_params_t *info = kzalloc(sizeof(task_params_t));
     info->func = entry;
     info->start = false;
-    info->params = kalloc(sizeof(len));
+    info->params = kalloc(len);
     memcpy(info->params, params, len);
     info->len = len;
 
@@ -20,6 +20,7 @@
 #include <kernel/stdc.h>
 #include <kernel/vfs.h>
 #include <kernel/core.h>
+#include <kernel/slab.h>
 #include <errno.h>
 #include <assert.h>
 
@@ -35,6 +36,7 @@ struct block_file {
     bbtree_t tree;
     splock_t lock;
     llhead_t llru;
+    llnode_t node;
 
     bool async;
 };
@@ -51,6 +53,16 @@ struct block_page {
     llnode_t nlru;
 };
 
+/* Lock and condition are kept initialized while the page sits in cache */
+static void block_page_ctor(void *ptr)
+{
+    block_page_t *page = ptr;
+    mtx_init(&page->mtx, mtx_plain);
+    cnd_init(&page->cnd);
+}
+
+static kmem_cache_t block_page_cache = INIT_KMEM_CACHE("block_page", block_page_t, block_page_ctor);
+
 size_t mmu_read(size_t address);
 
 bio_t *bio_create(inode_t *ino);
@@ -60,9 +72,16 @@ int bio_wait(bio_t *bio);
 
 /* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
 
-void block_scavenge(block_file_t *block, int max)
+llhead_t block_list = INIT_LLHEAD;
+splock_t block_lock = INIT_SPLOCK;
+
+int block_scavenge(block_file_t *block, int max, bool atomic)
 {
-    splock_lock(&block->lock);
+    int done = 0;
+    if (!atomic)
+        splock_lock(&block->lock);
+    else if (!splock_trylock(&block->lock))
+        return 0;
     while (max-- > 0) {
         block_page_t *page = ll_dequeue(&block->llru, block_page_t, nlru);
         if (page == NULL)
@@ -71,9 +90,42 @@ void block_scavenge(block_file_t *block, int max)
         // TODO -- Race condition, is page_mutex released !?
         bbtree_remove(&block->tree, lba);
         page_release(page->phys);
-        kfree(page);
+        kmem_cache_free(&block_page_cache, page);
+        done++;
     }
     splock_unlock(&block->lock);
+    return done;
+}
+
+/* Drop clean pages from the LRU of every block file */
+static int block_reclaim(int count, bool atomic)
+{
+    int done = 0;
+    if (!atomic)
+        splock_lock(&block_lock);
+    else if (!splock_trylock(&block_lock))
+        return 0;
+    block_file_t *block;
+    for ll_each(&block_list, block, block_file_t, node) {
+        if (done >= count)
+            break;
+        done += block_scavenge(block, count - done, atomic);
+    }
+    splock_unlock(&block_lock);
+    return done;
+}
+
+/* Shrinker of the page cache, drop clean pages first then unused fnodes */
+int vfs_reclaim(int count, int flags)
+{
+    bool atomic = (flags & PGR_ATOMIC) != 0;
+    int done = block_reclaim(count, atomic);
+
+    // Dropping fnodes close inodes, which might sleep. Fnodes are not pages,
+    // only the cached pages left unused count toward the target.
+    if (done < count && !atomic && __vfs_share != NULL && vfs_scavenge(count - done) > 0)
+        done += block_reclaim(count - done, false);
+    return done;
 }
 
 static int block_fill(inode_t *ino, block_page_t *page)
@@ -180,10 +232,13 @@ static block_page_t *block_get(inode_t *ino, xoff_t off, bool create)
             splock_unlock(&block->lock);
             return NULL;
         }
-        page = kalloc(sizeof(block_page_t));
-        mtx_init(&page->mtx, mtx_plain);
-        cnd_init(&page->cnd);
+        page = kmem_cache_alloc(&block_page_cache);
+        page->ready = false;
+        page->dirty = false;
+        page->in_ops = false;
+        page->phys = 0;
         page->rcu = 0;
+        memset(&page->nlru, 0, sizeof(llnode_t));
         page->node.value_ = lba;
         bbtree_insert(&block->tree, &page->node);
     } else if (ll_contains(&block->llru, &page->nlru))
@@ -348,10 +403,13 @@ void block_destroy(inode_t *ino)
         kprintf(KL_BIO, "Release page %p for inode %s at %llx\n", page->phys, vfs_inokey(ino, tmp), (xoff_t)page->node.value_ * PAGE_SIZE);
         page_release(page->phys);
         bbtree_remove(&block->tree, page->node.value_);
-        kfree(page);
+        kmem_cache_free(&block_page_cache, page);
         page = bbtree_first(&block->tree, block_page_t, node);
     }
 
+    splock_lock(&block_lock);
+    ll_remove(&block_list, &block->node);
+    splock_unlock(&block_lock);
     kfree(block);
 }
 
@@ -366,9 +424,12 @@ fl_ops_t block_ops = {
 
 block_file_t *block_create()
 {
-    block_file_t *block = kalloc(sizeof(block_file_t));
+    block_file_t *block = kzalloc(sizeof(block_file_t));
     splock_init(&block->lock);
     bbtree_init(&block->tree);
     block->async = false;
+    splock_lock(&block_lock);
+    ll_append(&block_list, &block->node);
+    splock_unlock(&block_lock);
     return block;
 }
@@ -19,6 +19,7 @@
  */
 #include <kernel/stdc.h>
 #include <kernel/vfs.h>
+#include <kernel/kprof.h>
 #include <threads.h>
 #include <errno.h>
 #include <assert.h>
@@ -218,7 +219,7 @@ dfs_iterator_t *devfs_opendir(inode_t *dir)
     dfs_info_t *info = dir->drv_data;
     dfs_entry_t *entry = devfs_fetch(info, dir->no);
 
-    dfs_iterator_t *it = kalloc(sizeof(dfs_iterator_t));
+    dfs_iterator_t *it = kzalloc(sizeof(dfs_iterator_t));
     it->entry = entry;
     it->idx = 0;
     return it;
@@ -331,6 +332,40 @@ int rand_read(inode_t *ino, char *buf, size_t len, xoff_t off, int flags)
     return len;
 }
 
+#define HEAPSTAT_SIZE  (4 * PAGE_SIZE)
+
+/* Read opertion of '/dev/heapstat', the heap profile report */
+int heapstat_read(inode_t *ino, char *buf, size_t len, xoff_t off, int flags)
+{
+    (void)ino;
+    char *tmp = kalloc(HEAPSTAT_SIZE);
+    int lg = kprof_report(tmp, HEAPSTAT_SIZE);
+    if (off >= lg) {
+        kfree(tmp);
+        errno = 0;
+        return 0;
+    }
+    len = MIN(len, (size_t)(lg - off));
+    memcpy(buf, &tmp[off], len);
+    kfree(tmp);
+    errno = 0;
+    return len;
+}
+
+/* Write opertion of '/dev/heapstat', set the sampling period and reset */
+int heapstat_write(inode_t *ino, const char *buf, size_t len, xoff_t off, int flags)
+{
+    (void)ino;
+    (void)off;
+    char tmp[12];
+    len = MIN(len, sizeof(tmp) - 1);
+    memcpy(tmp, buf, len);
+    tmp[len] = '\0';
+    kprof_setup(strtol(tmp, NULL, 10));
+    errno = 0;
+    return len;
+}
+
 ino_ops_t devfs_zero_ops = {
     .read = zero_read,
 };
@@ -344,6 +379,11 @@ ino_ops_t devfs_rand_ops = {
     .read = rand_read,
 };
 
+ino_ops_t devfs_heapstat_ops = {
+    .read = heapstat_read,
+    .write = heapstat_write,
+};
+
 /* -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-= */
 
 inode_t *DEV_INO;
@@ -420,7 +460,7 @@ inode_t *devfs_mount(inode_t *dev, const char *options)
 
 inode_t *devfs_setup()
 {
-    dfs_info_t *info = kalloc(sizeof(dfs_info_t));
+    dfs_info_t *info = kzalloc(sizeof(dfs_info_t));
     info->ctime = xtime_read(XTIME_CLOCK);
     info->table = devfs_extends(1);
 
@@ -459,6 +499,7 @@ inode_t *devfs_setup()
     devfs_dev(info, "zero", FL_CHR, DF_ROOT, &devfs_zero_ops);
     devfs_dev(info, "null", FL_CHR, DF_ROOT, &devfs_null_ops);
     devfs_dev(info, "random", FL_CHR, DF_ROOT, &devfs_rand_ops);
+    devfs_dev(info, "heapstat", FL_CHR, DF_ROOT, &devfs_heapstat_ops);
 
     vfs_addfs("devfs", devfs_mount, NULL);
 
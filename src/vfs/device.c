@@ -22,12 +22,15 @@
 #include <assert.h>
 #include <kernel/stdc.h>
 #include <kernel/vfs.h>
+#include <kernel/memory.h>
+#include <kernel/slab.h>
 #include <errno.h>
 #include <stdbool.h>
 #include <errno.h>
 #include <limits.h>
 
 vfs_share_t *__vfs_share = NULL;
+extern kmem_cache_t fnode_cache;
 inode_t *devfs_setup();
 
 void devfs_sweep();
@@ -36,14 +39,14 @@ void devfs_register(inode_t *ino, const char *name);
 fs_anchor_t *vfs_init()
 {
     assert(__vfs_share == NULL);
-    fs_anchor_t *fsanchor = kalloc(sizeof(fs_anchor_t));
-    __vfs_share = kalloc(sizeof(vfs_share_t));
+    fs_anchor_t *fsanchor = kzalloc(sizeof(fs_anchor_t));
+    __vfs_share = kzalloc(sizeof(vfs_share_t));
     atomic_inc(&__vfs_share->rcu);
     hmp_init(&__vfs_share->fs_hmap, 16);
 
     inode_t *ino = devfs_setup();
 
-    fnode_t *node = kalloc(sizeof(fnode_t));
+    fnode_t *node = kmem_cache_alloc(&fnode_cache);
     mtx_init(&node->mtx, mtx_plain);
     hmp_init(&node->map, 8);
     __vfs_share->root = node;
@@ -54,6 +57,7 @@ fs_anchor_t *vfs_init()
 
     __vfs_share->fsanchor = fsanchor;
     fsanchor->root = node;
+    page_shrinker(vfs_reclaim);
     fsanchor->pwd = node;
     fsanchor->umask = 022;
     fsanchor->rcu = 1;
@@ -68,7 +72,7 @@ fs_anchor_t *vfs_open_vfs(fs_anchor_t *fsanchor)
 
 fs_anchor_t *vfs_clone_vfs(fs_anchor_t *fsanchor)
 {
-    fs_anchor_t *cpy = kalloc(sizeof(fs_anchor_t));
+    fs_anchor_t *cpy = kzalloc(sizeof(fs_anchor_t));
     cpy->rcu = 1;
     atomic_inc(&__vfs_share->rcu);
     cpy->root = vfs_open_fnode(fsanchor->root);
@@ -115,7 +119,7 @@ int vfs_sweep(fs_anchor_t *fsanchor)
     fnode_t *root = __vfs_share->root;
     hmp_destroy(&root->map);
     vfs_close_inode(root->ino);
-    kfree(root);
+    kmem_cache_free(&fnode_cache, root);
 
     if (__vfs_share->fs_hmap.count != 0)
         return -1;
@@ -140,7 +144,7 @@ EXPORT_SYMBOL(vfs_rmdev, 0);
 
 void vfs_addfs(const char *name, fsmount_t mount, fsformat_t format)
 {
-    fsreg_t *reg = kalloc(sizeof(fsreg_t));
+    fsreg_t *reg = kzalloc(sizeof(fsreg_t));
     strncpy(reg->name, name, 16);
     reg->mount = mount;
     reg->format = format;
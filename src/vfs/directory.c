@@ -78,7 +78,7 @@ diterator_t *vfs_opendir(fs_anchor_t *fsanchor, const char *name, user_t *user)
     if (ctx == NULL)
         goto err;
 
-    diterator_t *it = kalloc(sizeof(diterator_t));
+    diterator_t *it = kzalloc(sizeof(diterator_t));
     it->ctx = ctx;
     it->mode = 0;
     it->dir = dir;
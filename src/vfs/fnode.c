@@ -2,6 +2,9 @@
 #include <errno.h>
 #include <fcntl.h>
 #include <limits.h>
+#include <kernel/slab.h>
+
+kmem_cache_t fnode_cache = INIT_KMEM_CACHE("fnode", fnode_t, NULL);
 
 fnode_t *vfs_fsnode_from(fnode_t *parent, const char *name)
 {
@@ -17,7 +20,7 @@ fnode_t *vfs_fsnode_from(fnode_t *parent, const char *name)
     splock_lock(&__vfs_share->fnode_lock);
     fnode_t *node = hmp_get(&parent->map, name, len);
     if (node == NULL) {
-        node = kalloc(sizeof(fnode_t));
+        node = kmem_cache_alloc(&fnode_cache);
         kprintf(KL_FSA, "Alloc new fsnode `%s/%s`\n", vfs_inokey(parent->ino, tmp), name);
         mtx_init(&node->mtx, mtx_plain);
         node->parent = vfs_open_fnode(parent);
@@ -62,9 +65,10 @@ void vfs_close_fnode(fnode_t *node)
     splock_unlock(&__vfs_share->fnode_lock);
 }
 
-void vfs_scavenge(int max)
+int vfs_scavenge(int max)
 {
     char tmp[16];
+    int done = 0;
     if (max <= 0)
         max = INT_MAX;
     might_sleep();
@@ -89,7 +93,8 @@ void vfs_scavenge(int max)
         hmp_destroy(&node->map);
         vfs_close_fnode_unlocked(node->parent);
         inode_t *ino = node->ino;
-        kfree(node);
+        kmem_cache_free(&fnode_cache, node);
+        done++;
 
         splock_unlock(&__vfs_share->fnode_lock);
     
@@ -100,6 +105,7 @@ void vfs_scavenge(int max)
         splock_lock(&__vfs_share->fnode_lock);
     }
     splock_unlock(&__vfs_share->fnode_lock);
+    return done;
 }
 
 fnode_t *vfs_open_fnode(fnode_t *node)
@@ -152,7 +152,7 @@ EXPORT_SYMBOL(memset32, 0);
 //
 //framebuffer_t *framebuffer_create()
 //{
-//    framebuffer_t *fb = (framebuffer_t *)kalloc(sizeof(framebuffer_t));
+//    framebuffer_t *fb = (framebuffer_t *)kzalloc(sizeof(framebuffer_t));
 //    fb->width = 0;
 //    fb->height = 0;
 //    // fb->depth = 32;
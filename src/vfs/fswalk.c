@@ -37,7 +37,7 @@ static fnode_t *vfs_release_path(path_t *path, bool keep_node)
 static path_t *vfs_breakup_path(fs_anchor_t *fsanchor, const char *path)
 {
     pelmt_t *el;
-    path_t *pl = kalloc(sizeof(path_t));
+    path_t *pl = kzalloc(sizeof(path_t));
     pl->node = vfs_open_fnode(*path == '/' ? fsanchor->root : fsanchor->pwd);
 
     while (*path) {
@@ -147,7 +147,7 @@ static int vfs_check_dir_inode(path_t *path, user_t *user, int *links, char **ln
         }
 
         if (*lnk_buf == NULL)
-            *lnk_buf = kalloc(PAGE_SIZE);
+            *lnk_buf = kzalloc(PAGE_SIZE);
         vfs_readsymlink(ino, *lnk_buf, PAGE_SIZE);
         if (vfs_concatpath(*lnk_buf, path) != 0) {
             vfs_close_inode(ino);
@@ -239,7 +239,7 @@ fnode_t *vfs_search(fs_anchor_t *fsanchor, const char *pathname, user_t *user, b
                     }
 
                     if (lnk_buf == NULL)
-                        lnk_buf = kalloc(PAGE_SIZE);
+                        lnk_buf = kzalloc(PAGE_SIZE);
                     vfs_readsymlink(ino, lnk_buf, PAGE_SIZE);
                     fnode_t *node = vfs_open_fnode(path->node->parent);
                     vfs_close_fnode(path->node);
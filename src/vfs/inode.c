@@ -9,7 +9,7 @@ inode_t *vfs_inode(unsigned no, ftype_t type, device_t *device, const ino_ops_t
 {
     char tmp[16];
     if (device == NULL) {
-        device = kalloc(sizeof(device_t));
+        device = kzalloc(sizeof(device_t));
         // TODO -- Give UniqueID / Register on
         device->no = atomic_xadd(&__vfs_share->dev_no, 1);
         splock_lock(&__vfs_share->lock);
@@ -30,7 +30,7 @@ inode_t *vfs_inode(unsigned no, ftype_t type, device_t *device, const ino_ops_t
         return inode;
     }
 
-    inode = (inode_t *)kalloc(sizeof(inode_t));
+    inode = (inode_t *)kzalloc(sizeof(inode_t));
     inode->no = no;
     inode->type = type;
     inode->dev = device;
@@ -131,7 +131,7 @@ int vfs_parts(const char *dname)
             ino->ino.lba = sector->parts[i].start;
             ino->ino.length = sector->parts[i].length * 512;
             ino->underlying = dev;
-            device_t *sdev = (device_t *)kalloc(sizeof(device_t));
+            device_t *sdev = (device_t *)kzalloc(sizeof(device_t));
             sdev->read_only = dev->read_only;
             sdev->block = dev->block;
             sdev->vendor = "MBR";
@@ -295,7 +295,7 @@ fl_ops_t chr_ops = {
 
 pipe_t *pipe_create()
 {
-    pipe_t *pipe = (pipe_t *)kalloc(sizeof(pipe_t));
+    pipe_t *pipe = (pipe_t *)kzalloc(sizeof(pipe_t));
     pipe->size = PAGE_SIZE; // TODO -- Read config!
     pipe->max_size = 64 * PAGE_SIZE;
     pipe->base = kmap(pipe->size, NULL, 0, VMA_PIPE | VM_RW); // TODO -- find name ?
@@ -155,7 +155,7 @@ inode_t *tar_lookup(inode_t *dir, const char *name, void *acl)
 /* Start an iterator to walk on a directory */
 tar_iterator_t *tar_opendir(inode_t *dir)
 {
-    tar_iterator_t *ctx = kalloc(sizeof(tar_iterator_t));
+    tar_iterator_t *ctx = kzalloc(sizeof(tar_iterator_t));
     tar_start_iterate(dir, ctx);
     return ctx;
 }
@@ -258,7 +258,7 @@ void tar_close(inode_t *ino)
 
 inode_t *tar_mount(void *base, size_t length, const char *name)
 {
-    tar_info_t *info = kalloc(sizeof(tar_info_t));
+    tar_info_t *info = kzalloc(sizeof(tar_info_t));
     info->rcu = 1;
     info->base = base;
     info->length = length;
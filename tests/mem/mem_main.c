@@ -22,11 +22,18 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
 #include <kora/mcrs.h>
 #include <kernel/memory.h>
 #include <kernel/dlib.h>
 #include <kernel/stdc.h>
 #include <kernel/blkmap.h>
+#include <kernel/slab.h>
+#include <kernel/kprof.h>
+#include <kernel/tasks.h>
+#include "../../src/stdc/allocator.h"
+#include <threads.h>
 #include <assert.h>
 #include <errno.h>
 
@@ -36,6 +43,9 @@
 
 int alloc_check();
 
+/* No reclaim task runs on the cli, allocations never wait for it */
+task_t *__current = NULL;
+
 
 struct
 {
@@ -71,7 +81,7 @@ void __create_mmu_dir(vmsp_t *vmsp)
     mmu_dir_t *dir = malloc(sizeof(mmu_dir_t) + sizeof(size_t) * len);
     memset(dir->pages, 0, sizeof(size_t) * len);
     dir->len = len;
-    dir->dir = page_new();
+    dir->dir = page_new_table();
     vmsp->t_size++;
     vmsp->directory = (size_t)dir;
 }
@@ -118,10 +128,11 @@ void mmu_leave()
     mmu_destroy_uspace(__mmu.kspace);
 }
 
-//void mmu_context(vmsp_t *mm)
-//{
-//    //_.pages = (size_t *)mm->directory;
-//}
+/* Pages tables are looked up on the selected space */
+void mmu_context(vmsp_t *vmsp)
+{
+    __mmu.uspace = vmsp;
+}
 
 vmsp_t *__mmu_set_vmsp = NULL;
 void mmu_create_uspace(vmsp_t *vmsp)
@@ -154,6 +165,68 @@ void mmu_destroy_uspace(vmsp_t *vmsp)
 void page_release_kmap_stub(size_t page);
 size_t mmu_read_kmap_stub(size_t address);
 
+#define MMU_HUGE 0x800
+
+/* Huge pages split since the last TLBINFO */
+static int __mmu_splits = 0;
+
+/* Huge pages are emulated by flagging each of their pages */
+static void __mmu_split(vmsp_t *vmsp, mmu_dir_t *dir, size_t idx)
+{
+    size_t base = ALIGN_DW(idx, HUGE_PAGE_PAGES);
+    for (size_t i = 0; i < HUGE_PAGE_PAGES; ++i)
+        dir->pages[base + i] &= ~MMU_HUGE;
+    vmsp->h_size--;
+    __mmu_splits++;
+}
+
+bool mmu_huge_usable(size_t vaddr)
+{
+    vmsp_t *vmsp = memory_space_at(vaddr);
+    if (vmsp == __mmu.kspace)
+        return false;
+    mmu_dir_t *dir = (void *)vmsp->directory;
+    size_t idx = (vaddr - vmsp->lower_bound) / PAGE_SIZE;
+    if ((idx % HUGE_PAGE_PAGES) != 0 || idx + HUGE_PAGE_PAGES > dir->len)
+        return false;
+    for (size_t i = 0; i < HUGE_PAGE_PAGES; ++i) {
+        if (dir->pages[idx + i] != 0)
+            return false;
+    }
+    return true;
+}
+
+size_t mmu_drop_huge(size_t vaddr)
+{
+    vmsp_t *vmsp = memory_space_at(vaddr);
+    assert(vmsp == __mmu.uspace);
+    mmu_dir_t *dir = (void *)vmsp->directory;
+    size_t idx = (vaddr - vmsp->lower_bound) / PAGE_SIZE;
+    assert((idx % HUGE_PAGE_PAGES) == 0);
+    if (idx + HUGE_PAGE_PAGES > dir->len || (dir->pages[idx] & MMU_HUGE) == 0)
+        return 0;
+    size_t phys = dir->pages[idx] & ~(PAGE_SIZE - 1);
+    size_t dirty = 0;
+    for (size_t i = 0; i < HUGE_PAGE_PAGES; ++i) {
+        if (dir->pages[idx + i] & 0x200)
+            dirty = MMU_DIRTY;
+        dir->pages[idx + i] = 0;
+    }
+    vmsp->h_size--;
+    return phys | dirty;
+}
+
+void mmu_resolve_huge(size_t vaddr, size_t phys, int flags)
+{
+    vmsp_t *vmsp = memory_space_at(vaddr);
+    assert(vmsp == __mmu.uspace);
+    mmu_dir_t *dir = (void *)vmsp->directory;
+    size_t idx = (vaddr - vmsp->lower_bound) / PAGE_SIZE;
+    assert((phys & (HUGE_PAGE_SIZE - 1)) == 0);
+    for (size_t i = 0; i < HUGE_PAGE_PAGES; ++i)
+        dir->pages[idx + i] = (phys + i * PAGE_SIZE) | 8 | MMU_HUGE | (flags & (VM_RWX | VM_UNCACHABLE));
+}
+
 static size_t __mmu_set(mmu_dir_t *dir, size_t idx, size_t phys, int flags)
 {
     assert(idx < dir->len);
@@ -177,7 +250,7 @@ size_t mmu_resolve(size_t vaddr, size_t phys, int flags)
     assert(vaddr >= vmsp->lower_bound && vaddr < vmsp->upper_bound);
     assert(vmsp == __mmu.kspace || vmsp == __mmu.uspace);
     if (phys == 0)
-        phys = page_new();
+        phys = page_new_table();
 
     mmu_dir_t *dir = (void *)vmsp->directory;
     size_t idx = (vaddr - vmsp->lower_bound) / PAGE_SIZE;
@@ -223,6 +296,8 @@ size_t mmu_drop(size_t vaddr)
     mmu_dir_t *dir = (void *)vmsp->directory;
     size_t idx = (vaddr - vmsp->lower_bound) / PAGE_SIZE;
     assert(idx < dir->len);
+    if (dir->pages[idx] & MMU_HUGE)
+        __mmu_split(vmsp, dir, idx);
     size_t phys = dir->pages[idx] & ~(PAGE_SIZE - 1);
     dir->pages[idx] = 0;
     return phys;
@@ -239,6 +314,8 @@ size_t mmu_protect(size_t vaddr, int flags)
     size_t idx = (vaddr - vmsp->lower_bound) / PAGE_SIZE;
     assert(idx < dir->len);
     size_t phys = 0;
+    if (dir->pages[idx] & MMU_HUGE)
+        __mmu_split(vmsp, dir, idx);
     if (dir->pages[idx] != 0) {
         phys = dir->pages[idx] & ~(PAGE_SIZE - 1);
         dir->pages[idx] = phys | 8 | (flags & (VM_RWX | VM_UNCACHABLE));
@@ -246,7 +323,83 @@ size_t mmu_protect(size_t vaddr, int flags)
     return phys;
 
 }
+
+/* Huge pages are kept if the range covers them, split otherwise */
+static bool __mmu_range_huge(vmsp_t *vmsp, mmu_dir_t *dir, size_t idx, size_t start, size_t end)
+{
+    size_t base = ALIGN_DW(idx, HUGE_PAGE_PAGES);
+    if (base >= start && base + HUGE_PAGE_PAGES <= end)
+        return true;
+    __mmu_split(vmsp, dir, idx);
+    return false;
+}
+
 /* - */
+size_t mmu_protect_range(size_t vaddr, size_t length, int flags)
+{
+    vmsp_t *vmsp = memory_space_at(vaddr);
+    assert(vaddr >= vmsp->lower_bound && vaddr + length <= vmsp->upper_bound);
+    assert(vmsp == __mmu.kspace || vmsp == __mmu.uspace);
+
+    mmu_dir_t *dir = (void *)vmsp->directory;
+    size_t start = (vaddr - vmsp->lower_bound) / PAGE_SIZE;
+    size_t end = start + length / PAGE_SIZE;
+    assert(end <= dir->len);
+    size_t count = 0;
+    for (size_t idx = start; idx < end; ++idx) {
+        size_t huge = 0;
+        if (dir->pages[idx] & MMU_HUGE && __mmu_range_huge(vmsp, dir, idx, start, end))
+            huge = MMU_HUGE;
+        if (dir->pages[idx] != 0) {
+            size_t phys = dir->pages[idx] & ~(PAGE_SIZE - 1);
+            dir->pages[idx] = phys | 8 | huge | (flags & (VM_RWX | VM_UNCACHABLE));
+            count++;
+        }
+    }
+    return count;
+}
+
+/* - */
+size_t mmu_drop_range(size_t vaddr, size_t length, size_t *pages)
+{
+    vmsp_t *vmsp = memory_space_at(vaddr);
+    assert(vaddr >= vmsp->lower_bound && vaddr + length <= vmsp->upper_bound);
+    assert(vmsp == __mmu.kspace || vmsp == __mmu.uspace);
+
+    mmu_dir_t *dir = (void *)vmsp->directory;
+    size_t start = (vaddr - vmsp->lower_bound) / PAGE_SIZE;
+    size_t end = start + length / PAGE_SIZE;
+    assert(end <= dir->len);
+    for (size_t idx = start; idx < end; ++idx) {
+        if (dir->pages[idx] & MMU_HUGE && __mmu_range_huge(vmsp, dir, idx, start, end)) {
+            // The whole huge page goes away
+            if (idx == ALIGN_DW(idx, HUGE_PAGE_PAGES))
+                vmsp->h_size--;
+        }
+        size_t entry = dir->pages[idx];
+        size_t phys = entry & ~(PAGE_SIZE - 1);
+        *(pages++) = phys != 0 && (entry & 0x200) ? phys | MMU_DIRTY : phys;
+        dir->pages[idx] = 0;
+    }
+    // Pages are stored on a flat array, there is no table to release
+    return 0;
+}
+
+/* - */
+/* The accessed bit is emulated, set by TOUCH */
+bool mmu_young(size_t vaddr)
+{
+    vmsp_t *vmsp = memory_space_at(vaddr);
+    assert(vmsp == __mmu.kspace || vmsp == __mmu.uspace);
+
+    mmu_dir_t *dir = (void *)vmsp->directory;
+    size_t idx = (vaddr - vmsp->lower_bound) / PAGE_SIZE;
+    assert(idx < dir->len);
+    bool young = dir->pages[idx] & 0x100;
+    dir->pages[idx] &= ~0x100;
+    return young;
+}
+
 bool mmu_dirty(size_t vaddr)
 {
     vmsp_t *vmsp = memory_space_at(vaddr);
@@ -474,6 +627,8 @@ int do_touch(void *ctx, size_t *params)
         return -1;
     }
 
+    if (vmsp != NULL)
+        dir->pages[idx] |= 0x100;
     if (access & VM_WR && vmsp != NULL)
         dir->pages[idx] |= 0x200;
     return 0;
@@ -490,12 +645,12 @@ int do_touch(void *ctx, size_t *params)
 //    size_t dt = cli_read_size((char *)params[2]);
 //
 //    dlib_t *lib = dlib_create(name);
-//    dlsection_t *sc = kalloc(sizeof(dlsection_t));
+//    dlsection_t *sc = kzalloc(sizeof(dlsection_t));
 //    sc->length = cd;
 //    sc->rights = 5;
 //    ll_append(&lib->sections, &sc->node);
 //
-//    sc = kalloc(sizeof(dlsection_t));
+//    sc = kzalloc(sizeof(dlsection_t));
 //    sc->offset = cd;
 //    sc->length = dt;
 //    sc->rights = 6;
@@ -525,6 +680,20 @@ int do_touch(void *ctx, size_t *params)
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 
 
+/* A cache of pages, able to give them back under memory pressure */
+size_t hoard_pages[256];
+int hoard_count = 0;
+
+int hoard_shrink(int count, int flags)
+{
+    int done = 0;
+    while (hoard_count > 0 && done < count) {
+        page_release(hoard_pages[--hoard_count]);
+        done++;
+    }
+    return done;
+}
+
 int do_start(void *ctx, size_t *params)
 {
     size_t ksize = cli_read_size((char *)params[0]);
@@ -536,6 +705,7 @@ int do_start(void *ctx, size_t *params)
     _.pages_count = pages;
     memory_initialize();
     memory_info();
+    page_shrinker(hoard_shrink);
 
     dlproc_t *proc = dlib_proc();
     dlib_t *lib = dlib_create("kernel", NULL);
@@ -563,6 +733,7 @@ int do_start(void *ctx, size_t *params)
 
 int do_quit()
 {
+    hoard_shrink(hoard_count, 0);
     memory_sweep();
     
     // mspace_sweep(__mmu.kspace);
@@ -643,6 +814,38 @@ int __munmap(vmsp_t *vmsp, size_t *params)
     return vmsp_unmap(vmsp, base, length);
 }
 
+int __areas(vmsp_t *vmsp, size_t *params)
+{
+    size_t count = cli_read_size((char *)params[0]);
+    if (vmsp == NULL)
+        return cli_error("No user-space selected");
+    if (vmsp->areas != count || vmsp->tree.count_ != (int)count)
+        return cli_error("Expected %d areas, found %d", (int)count, (int)vmsp->areas);
+    return 0;
+}
+
+int __pages(vmsp_t *vmsp, size_t *params)
+{
+    size_t private = cli_read_size((char *)params[0]);
+    size_t shared = cli_read_size((char *)params[1]);
+    if (vmsp == NULL)
+        return cli_error("No user-space selected");
+    if (vmsp->p_size != private || vmsp->s_size != shared)
+        return cli_error("Expected %d private and %d shared pages, found %d and %d",
+            (int)private, (int)shared, (int)vmsp->p_size, (int)vmsp->s_size);
+    return 0;
+}
+
+int __deferred(vmsp_t *vmsp, size_t *params)
+{
+    size_t deferred = cli_read_size((char *)params[0]);
+    if (vmsp == NULL)
+        return cli_error("No user-space selected");
+    if (vmsp->d_size != deferred)
+        return cli_error("Expected %d deferred pages, found %d", (int)deferred, (int)vmsp->d_size);
+    return 0;
+}
+
 int __mprotect(vmsp_t *vmsp, size_t *params)
 {
     char *bname = (char *)params[0];
@@ -657,6 +860,29 @@ int __mprotect(vmsp_t *vmsp, size_t *params)
     return vmsp_protect(vmsp, base, length, flags); // !?
 }
 
+int __madvise(vmsp_t *vmsp, size_t *params)
+{
+    const char *hints[] = { "NORMAL", "RANDOM", "SEQUENTIAL", "WILLNEED", "DONTNEED" };
+    const char *merges[] = { "MERGEABLE", "UNMERGEABLE" };
+    char *bname = (char *)params[0];
+    size_t base = read_address2(bname);
+    size_t length = cli_read_size((char *)params[1]);
+    char *arg = (char *)params[2];
+
+    if (vmsp == NULL)
+        return cli_error("No user-space selected");
+
+    for (int i = 0; i < 5; ++i) {
+        if (strcmp(arg, hints[i]) == 0)
+            return vmsp_advise(vmsp, base, length, VMA_ADV_NORMAL + i);
+    }
+    for (int i = 0; i < 2; ++i) {
+        if (strcmp(arg, merges[i]) == 0)
+            return vmsp_advise(vmsp, base, length, VMA_ADV_MERGEABLE + i);
+    }
+    return cli_error("Unknown access hint %s", arg);
+}
+
 int __dlib(vmsp_t *vmsp, size_t *params)
 {
     char *name = (char *)params[0];
@@ -730,11 +956,36 @@ int do_munmap(void *ctx, size_t *params)
     return __munmap(__mmu.uspace, params);
 }
 
+int do_kareas(void *ctx, size_t *params)
+{
+    return __areas(__mmu.kspace, params);
+}
+
+int do_mareas(void *ctx, size_t *params)
+{
+    return __areas(__mmu.uspace, params);
+}
+
+int do_mpages(void *ctx, size_t *params)
+{
+    return __pages(__mmu.uspace, params);
+}
+
+int do_mdeferred(void *ctx, size_t *params)
+{
+    return __deferred(__mmu.uspace, params);
+}
+
 int do_mprotect(void *ctx, size_t *params)
 {
     return __mprotect(__mmu.uspace, params);
 }
 
+int do_madvise(void *ctx, size_t *params)
+{
+    return __madvise(__mmu.uspace, params);
+}
+
 int do_mdlib(void *ctx, size_t *params)
 {
     return __dlib(__mmu.uspace, params);
@@ -839,6 +1090,635 @@ int do_mmu_release(void *ctx, size_t *params)
     return 0;
 }
 
+int do_page_get(void *ctx, size_t *params)
+{
+    char *zone = (char *)params[0];
+    int count = cli_read_size((char *)params[1]);
+    char *store = (char *)params[2];
+
+    int zn = strcmp(zone, "DMA") == 0 ? PGZ_DMA : PGZ_ANY;
+    size_t base = page_get(zn, count);
+    if (base == 0)
+        return -1;
+    if (zn == PGZ_DMA && base + count * PAGE_SIZE > PGZ_DMA_LIMIT)
+        return cli_error("Pages %p are not reachable by DMA", (void *)base);
+
+    pagesbuf_t *ptr = malloc(sizeof(pagesbuf_t) + count * sizeof(size_t));
+    ptr->count = count;
+    for (int i = 0; i < count; ++i)
+        ptr->pages[i] = base + i * PAGE_SIZE;
+
+    cli_store(store, ptr, ST_PAGESBUF);
+    return 0;
+}
+
+int do_page_new(void *ctx, size_t *params)
+{
+    int count = cli_read_size((char *)params[0]);
+    char *store = (char *)params[1];
+
+    pagesbuf_t *ptr = malloc(sizeof(pagesbuf_t) + count * sizeof(size_t));
+    ptr->count = count;
+    for (int i = 0; i < count; ++i) {
+        ptr->pages[i] = page_new();
+        if (ptr->pages[i] == 0) {
+            while (i-- > 0)
+                page_release(ptr->pages[i]);
+            free(ptr);
+            return -1;
+        }
+    }
+
+    cli_store(store, ptr, ST_PAGESBUF);
+    return 0;
+}
+
+int do_tlbinfo(void *ctx, size_t *params)
+{
+    vmsp_t *vmsp = __mmu.uspace;
+    if (vmsp == NULL)
+        return cli_error("No user space selected");
+    size_t entries = vmsp->p_size + vmsp->s_size - vmsp->h_size * (HUGE_PAGE_PAGES - 1);
+    int splits = __mmu_splits;
+    __mmu_splits = 0;
+    printf("TLB: %d pages mapped, %d huge pages, %d entries required, %d entries saved, %d splits\n",
+        (int)(vmsp->p_size + vmsp->s_size), (int)vmsp->h_size, (int)entries,
+        (int)(vmsp->h_size * (HUGE_PAGE_PAGES - 1)), splits);
+    if (params[0] != 0 && vmsp->h_size != cli_read_size((char *)params[0]))
+        return cli_error("Expected %d huge pages", (int)cli_read_size((char *)params[0]));
+    if (params[1] != 0 && splits != (int)cli_read_size((char *)params[1]))
+        return cli_error("Expected %d huge pages split", (int)cli_read_size((char *)params[1]));
+    return 0;
+}
+
+int do_merge_scan(void *ctx, size_t *params)
+{
+    if (__mmu.uspace == NULL)
+        return cli_error("No user space selected");
+    int expected = cli_read_size((char *)params[0]);
+    int merged = merge_scan();
+    if (merged != expected)
+        return cli_error("Expected %d merged pages, found %d", expected, merged);
+    return 0;
+}
+
+int do_page_zero(void *ctx, size_t *params)
+{
+    int count = cli_read_size((char *)params[0]);
+    if (page_zero_fill(count) != count)
+        return cli_error("Pool of zeroed pages is full");
+    return 0;
+}
+
+int do_kmap_atomic(void *ctx, size_t *params)
+{
+    int depth = cli_read_size((char *)params[0]);
+    size_t pages[8];
+    void *ptrs[8];
+    if (depth <= 0 || depth > 8)
+        return cli_error("Invalid depth");
+    for (int i = 0; i < depth; ++i) {
+        pages[i] = page_new();
+        ptrs[i] = kmap_atomic(pages[i], VM_RW);
+        if (mmu_read((size_t)ptrs[i]) != pages[i])
+            return cli_error("Slot %d doesn't map its page", i);
+        if (i > 0 && ptrs[i] == ptrs[i - 1])
+            return cli_error("Nested slots share an address");
+    }
+    for (int i = depth; i-- > 0; ) {
+        kunmap_atomic(ptrs[i]);
+        if (mmu_read((size_t)ptrs[i]) != 0)
+            return cli_error("Slot %d is still mapped", i);
+        page_release(pages[i]);
+    }
+    return 0;
+}
+
+int do_page_cache(void *ctx, size_t *params)
+{
+    int low = cli_read_size((char *)params[0]);
+    int high = cli_read_size((char *)params[1]);
+    return page_cache_tune(low, high);
+}
+
+int do_page_hoard(void *ctx, size_t *params)
+{
+    int count = cli_read_size((char *)params[0]);
+    if (count == 0 && hoard_count != 0)
+        return cli_error("Hoard still holds %d pages", hoard_count);
+    if (hoard_count + count > 256)
+        return cli_error("Hoard is too small");
+    while (count-- > 0)
+        hoard_pages[hoard_count++] = page_new();
+    return 0;
+}
+
+#define KMEM_MARK  0x5a5a5a5a
+
+static void kmem_test_ctor(void *ptr)
+{
+    ((int *)ptr)[0] = KMEM_MARK;
+}
+
+int do_kmem_cache(void *ctx, size_t *params)
+{
+    int count = cli_read_size((char *)params[0]);
+    size_t size = cli_read_size((char *)params[1]);
+    if (count > 1024 || size < sizeof(int))
+        return cli_error("Invalid cache parameters");
+    int *objs[1024];
+    kmem_cache_t *zcache = kmem_cache_create("test", size, NULL);
+    kmem_cache_t *ccache = kmem_cache_create("test_ctor", size, kmem_test_ctor);
+
+    // Objects are zeroed without constructor, constructed state is kept otherwise
+    for (int j = 0; j < 2; ++j) {
+        kmem_cache_t *cache = j == 0 ? zcache : ccache;
+        int expected = j == 0 ? 0 : KMEM_MARK;
+        for (int i = 0; i < count; ++i) {
+            objs[i] = kmem_cache_alloc(cache);
+            if (objs[i][0] != expected)
+                return cli_error("Object %d of %s is not initialized", i, cache->name);
+            objs[i][0] = i;
+        }
+        for (int i = 0; i < count; i += 2)
+            kmem_cache_free(cache, objs[i]);
+        for (int i = 1; i < count; i += 2) {
+            if (objs[i][0] != i)
+                return cli_error("Object %d of %s has been overwritten", i, cache->name);
+            objs[i][0] = expected;
+            kmem_cache_free(cache, objs[i]);
+        }
+        for (int i = 0; i < count; ++i) {
+            objs[i] = kmem_cache_alloc(cache);
+            if (j == 0 && objs[i][0] != 0)
+                return cli_error("Object %d of %s is not zeroed", i, cache->name);
+        }
+        printf("Cache %s: %d objects on %d slabs\n", cache->name, count, cache->slabs);
+        for (int i = 0; i < count; ++i)
+            kmem_cache_free(cache, objs[i]);
+        kmem_cache_shrink(cache);
+        if (cache->slabs != 0 || cache->inuse != 0)
+            return cli_error("Cache %s still holds %d slabs", cache->name, cache->slabs);
+    }
+
+    kmem_cache_destroy(zcache);
+    kmem_cache_destroy(ccache);
+    return 0;
+}
+
+int do_heap_arena(void *ctx, size_t *params)
+{
+    int count = cli_read_size((char *)params[0]);
+    size_t length = 512 * _Kib_;
+    heap_arena_t arena;
+    char *objs[128];
+    size_t lens[128];
+    char *base = malloc(length);
+    setup_arena(&arena, (size_t)base, length, 16 * _Kib_, HEAP_CHECK | HEAP_PARANO);
+    memset(objs, 0, sizeof(objs));
+
+    srand(count);
+    for (int n = 0; n < count; ++n) {
+        int i = rand() % 128;
+        if (objs[i] != NULL) {
+            for (size_t j = 0; j < lens[i]; ++j) {
+                if (objs[i][j] != (char)i)
+                    return cli_error("Block %d has been overwritten", i);
+            }
+            // Resize in place when possible, release otherwise
+            size_t len = rand() % 4 != 0 ? 0 : rand() % 960 + 1;
+            if (len != 0 && realloc_r(&arena, objs[i], len) != NULL) {
+                if (msize_r(objs[i]) < len)
+                    return cli_error("Block %d has been shrunk", i);
+                lens[i] = len;
+                memset(objs[i], i, len);
+                continue;
+            }
+            free_r(&arena, objs[i]);
+            objs[i] = NULL;
+            continue;
+        }
+        // Mostly small blocks, a few larger ones
+        lens[i] = rand() % 8 != 0 ? rand() % 480 + 1 : rand() % (12 * _Kib_) + 1;
+        objs[i] = malloc_r(&arena, lens[i]);
+        if (objs[i] == NULL)
+            return cli_error("Unable to allocate %d bytes", lens[i]);
+        memset(objs[i], i, lens[i]);
+    }
+
+    for (int i = 0; i < 128; ++i) {
+        if (objs[i] != NULL)
+            free_r(&arena, objs[i]);
+    }
+    int flags = arena.flags_;
+    size_t used = arena.used_;
+    free(base);
+    if (flags & HEAP_CORRUPTED)
+        return cli_error("Arena is corrupted");
+    if (used != 0)
+        return cli_error("Arena still uses %d bytes", used);
+    return 0;
+}
+
+extern thread_local int __cpu_no;
+static int heap_bench_count;
+
+static int heap_bench_worker(void *arg)
+{
+    unsigned seed = (unsigned)(size_t)arg;
+    char *objs[64];
+    memset(objs, 0, sizeof(objs));
+    __cpu_no = (int)(size_t)arg;
+    for (int n = 0; n < heap_bench_count; ++n) {
+        int i = rand_r(&seed) % 64;
+        if (objs[i] != NULL) {
+            free_p(objs[i]);
+            objs[i] = NULL;
+        } else {
+            objs[i] = malloc_p(rand_r(&seed) % 200 + 1);
+            objs[i][0] = (char)i;
+        }
+    }
+    for (int i = 0; i < 64; ++i) {
+        if (objs[i] != NULL)
+            free_p(objs[i]);
+    }
+    return 0;
+}
+
+int do_heap_bench(void *ctx, size_t *params)
+{
+    int threads = cli_read_size((char *)params[0]);
+    heap_bench_count = cli_read_size((char *)params[1]);
+    size_t length = 4 * _Mib_;
+    thrd_t thrds[16];
+    if (threads < 1 || threads > 16)
+        return cli_error("Invalid thread count");
+
+    void *base = kmap(length, NULL, 0, VMA_HEAP | VM_RW);
+    setup_allocator(base, length);
+    xtime_t start = xtime_read(XTIME_CLOCK);
+    for (int i = 0; i < threads; ++i)
+        thrd_create(&thrds[i], heap_bench_worker, (void *)(size_t)i);
+    for (int i = 0; i < threads; ++i)
+        thrd_join(thrds[i], NULL);
+    xtime_t elapsed = xtime_read(XTIME_CLOCK) - start;
+    long ops = (long)threads * heap_bench_count;
+    printf("Heap bench: %d threads, %ld ops in %ld us, %ld ops/ms\n", threads, ops,
+           (long)elapsed, elapsed > 0 ? (long)(ops * 1000 / elapsed) : 0);
+    sweep_allocator();
+    kunmap(base, length);
+    return 0;
+}
+
+/* Map thousands of pages, alternating rights so they aren't merged, punch
+   a hole every other one and map larger areas which can't fit into them */
+int do_vmsp_bench(void *ctx, size_t *params)
+{
+    int count = cli_read_size((char *)params[0]);
+    vmsp_t *prev = __mmu.uspace;
+    vmsp_t *vmsp = vmsp_create();
+    size_t *bases = malloc(count * sizeof(size_t));
+    __mmu.uspace = vmsp;
+    if ((size_t)count * 3 * PAGE_SIZE / 2 > vmsp->upper_bound - vmsp->lower_bound) {
+        free(bases);
+        vmsp_close(vmsp);
+        __mmu.uspace = prev;
+        return cli_error("Too many areas for the address space");
+    }
+
+    xtime_t start = xtime_read(XTIME_CLOCK);
+    for (int i = 0; i < count; ++i) {
+        bases[i] = vmsp_map(vmsp, 0, PAGE_SIZE, NULL, 0, VMA_ANON | (i & 1 ? VM_RW : VM_RD));
+        if (bases[i] == 0)
+            return cli_error("Unable to map area %d", i);
+    }
+    for (int i = 0; i < count; i += 2)
+        vmsp_unmap(vmsp, bases[i], PAGE_SIZE);
+    for (int i = 0; i < count; i += 4) {
+        size_t base = vmsp_map(vmsp, 0, 2 * PAGE_SIZE, NULL, 0, VMA_ANON | VM_RW);
+        if (base < bases[count - 1])
+            return cli_error("Area %d mapped over a hole", i);
+    }
+    xtime_t elapsed = xtime_read(XTIME_CLOCK) - start;
+    printf("VMSP bench: %d areas, %d mappings in %ld us\n", (int)vmsp->areas,
+           count + count / 4, (long)elapsed);
+    free(bases);
+    vmsp_close(vmsp);
+    __mmu.uspace = prev;
+    return 0;
+}
+
+static xtime_t populate_bench_run(vmsp_t *vmsp, size_t length, void *ino, int flags, size_t *missing)
+{
+    xtime_t start = xtime_read(XTIME_CLOCK);
+    size_t base = vmsp_map(vmsp, 0, length, ino, 0, flags);
+    if (!(flags & VM_RESOLVE)) {
+        for (size_t off = 0; off < length; off += PAGE_SIZE) {
+            if (mmu_read(base + off) == 0)
+                vmsp_resolve(vmsp, base + off, true, flags & VM_WR);
+        }
+    }
+    xtime_t elapsed = xtime_read(XTIME_CLOCK) - start;
+    *missing = 0;
+    for (size_t off = 0; off < length; off += PAGE_SIZE) {
+        if (mmu_read(base + off) == 0)
+            (*missing)++;
+    }
+    vmsp_unmap(vmsp, base, length);
+    return elapsed;
+}
+
+/* Compare faulting a whole mapping page by page with populating it at once */
+int do_populate_bench(void *ctx, size_t *params)
+{
+    size_t length = cli_read_size((char *)params[0]);
+    char *iname = (char *)params[1];
+    int flags = VMA_ANON | VM_RW;
+    void *ino = NULL;
+    if (iname != NULL) {
+        ino = vfs_search_ino(NULL, iname, NULL, true);
+        if (ino == NULL)
+            return cli_error("Can't open file '%s'", iname);
+        flags = VMA_FILE | VM_RD;
+    }
+
+    vmsp_t *prev = __mmu.uspace;
+    vmsp_t *vmsp = vmsp_create();
+    __mmu.uspace = vmsp;
+    size_t missing = 0;
+    // Both runs find the file pages in the cache
+    if (ino != NULL)
+        populate_bench_run(vmsp, length, ino, flags | VM_RESOLVE, &missing);
+    xtime_t lazy = populate_bench_run(vmsp, length, ino, flags, &missing);
+    xtime_t eager = populate_bench_run(vmsp, length, ino, flags | VM_RESOLVE, &missing);
+    printf("Populate bench: %d pages, lazy %ld us, populated %ld us, %ld us saved\n",
+           (int)(length / PAGE_SIZE), (long)lazy, (long)eager, (long)(lazy - eager));
+    vmsp_close(vmsp);
+    __mmu.uspace = prev;
+    if (ino != NULL)
+        vfs_close_inode(ino);
+    if (missing != 0)
+        return cli_error("%d pages were not populated", (int)missing);
+    return 0;
+}
+
+/* Set the sampling period of the heap profiler, or print its report */
+int do_heapstat(void *ctx, size_t *params)
+{
+    if (params[0] != 0) {
+        kprof_setup(cli_read_size((char *)params[0]));
+        return 0;
+    }
+    char *buf = malloc(4 * PAGE_SIZE);
+    kprof_report(buf, 4 * PAGE_SIZE);
+    printf("%s", buf);
+    free(buf);
+    return 0;
+}
+
+int do_page_reclaim(void *ctx, size_t *params)
+{
+    int count = cli_read_size((char *)params[0]);
+    int done = page_reclaim(count, PGR_USPACE);
+    printf("Reclaimed %d pages\n", done);
+    if (done < count)
+        return cli_error("Only %d pages reclaimed out of %d", done, count);
+    return 0;
+}
+
+int do_page_watermark(void *ctx, size_t *params)
+{
+    int low = cli_read_size((char *)params[0]);
+    int high = cli_read_size((char *)params[1]);
+    return page_reclaim_tune(low, high);
+}
+
+/* Take every free page, from the largest blocks down to single ones */
+int do_page_exhaust(void *ctx, size_t *params)
+{
+    char *store = (char *)params[0];
+    int count = __mmu.pages_amount;
+    pagesbuf_t *ptr = malloc(sizeof(pagesbuf_t) + count * sizeof(size_t));
+    ptr->count = 0;
+    for (int order = PAGE_ORDERS - 1; order >= 0; --order) {
+        for (;;) {
+            size_t base = page_get(PGZ_ANY, 1 << order);
+            if (base == 0)
+                break;
+            for (int i = 0; i < (1 << order); ++i)
+                ptr->pages[ptr->count++] = base + i * PAGE_SIZE;
+        }
+    }
+    errno = 0;
+    cli_store(store, ptr, ST_PAGESBUF);
+    return 0;
+}
+
+int do_swapon(void *ctx, size_t *params)
+{
+    size_t size = cli_read_size((char *)params[0]);
+    int fd = open("swap.img", O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1 || ftruncate(fd, size) != 0)
+        return cli_error("Unable to create swap file");
+    close(fd);
+    inode_t *ino = vfs_search_ino(NULL, "swap.img", NULL, true);
+    int ret = swap_activate(ino);
+    vfs_close_inode(ino);
+    return ret;
+}
+
+int do_swapoff(void *ctx, size_t *params)
+{
+    if (swap_deactivate() != 0)
+        return -1;
+    unlink("swap.img");
+    return 0;
+}
+
+/* Check the selected space holds at least `n` pages on the swap */
+int do_swapped(void *ctx, size_t *params)
+{
+    vmsp_t *vmsp = __mmu.uspace;
+    if (vmsp == NULL)
+        return cli_error("No user space selected");
+    size_t count = cli_read_size((char *)params[0]);
+    if (vmsp->w_size < count)
+        return cli_error("Expected %d pages on the swap, found %d", (int)count, (int)vmsp->w_size);
+    return 0;
+}
+
+/* Check if the page at an address is on the swap (1) or not (0) */
+int do_swap_slot(void *ctx, size_t *params)
+{
+    vmsp_t *vmsp = __mmu.uspace;
+    if (vmsp == NULL)
+        return cli_error("No user space selected");
+    size_t address = read_address2((char *)params[0]);
+    bool expected = cli_read_size((char *)params[1]) != 0;
+    splock_lock(&vmsp->plock);
+    long slot = swap_lookup(vmsp, address);
+    splock_unlock(&vmsp->plock);
+    if ((slot != 0) != expected)
+        return cli_error("Page at %p is %s the swap", (void *)address, slot != 0 ? "on" : "not on");
+    return 0;
+}
+
+/* Share the swap slot of a page with `n` more users, then release them */
+int do_swap_share(void *ctx, size_t *params)
+{
+    vmsp_t *vmsp = __mmu.uspace;
+    if (vmsp == NULL)
+        return cli_error("No user space selected");
+    size_t address = read_address2((char *)params[0]);
+    int count = cli_read_size((char *)params[1]);
+    splock_lock(&vmsp->plock);
+    long slot = swap_lookup(vmsp, address);
+    splock_unlock(&vmsp->plock);
+    if (slot == 0)
+        return cli_error("No swap slot at %p", (void *)address);
+    for (int i = 0; i < count; ++i)
+        swap_dup(slot);
+    for (int i = 0; i < count; ++i)
+        swap_free(slot);
+    return 0;
+}
+
+/* Time a clone replaced right away by a new image, then one read entirely */
+int do_clone_bench(void *ctx, size_t *params)
+{
+    size_t length = cli_read_size((char *)params[0]);
+    vmsp_t *prev = __mmu.uspace;
+    vmsp_t *vmsp = vmsp_create();
+    __mmu.uspace = vmsp;
+    size_t base = vmsp_map(vmsp, 0, length, NULL, 0, VMA_ANON | VM_RW | VM_RESOLVE);
+
+    xtime_t start = xtime_read(XTIME_CLOCK);
+    vmsp_t *child = vmsp_clone(vmsp);
+    __mmu.uspace = child;
+    vmsp_close(child);
+    xtime_t spawn = xtime_read(XTIME_CLOCK) - start;
+
+    __mmu.uspace = vmsp;
+    start = xtime_read(XTIME_CLOCK);
+    child = vmsp_clone(vmsp);
+    __mmu.uspace = child;
+    for (size_t off = 0; off < length; off += PAGE_SIZE)
+        vmsp_resolve(child, base + off, true, false);
+    xtime_t fork = xtime_read(XTIME_CLOCK) - start;
+    size_t deferred = child->d_size;
+    vmsp_close(child);
+
+    __mmu.uspace = vmsp;
+    vmsp_close(vmsp);
+    __mmu.uspace = prev;
+    printf("Clone bench: %d pages, clone and exec %ld us, clone and read all %ld us\n",
+           (int)(length / PAGE_SIZE), (long)spawn, (long)fork);
+    if (deferred != 0)
+        return cli_error("%d pages still deferred", (int)deferred);
+    return 0;
+}
+
+int do_zswap(void *ctx, size_t *params)
+{
+    zswap_setup(cli_read_size((char *)params[0]));
+    return 0;
+}
+
+/* Round-trip a generated page through the zswap codec: RANDOM words,
+ * REPEAT of a short pattern or NOISE of random bytes */
+int do_zswap_codec(void *ctx, size_t *params)
+{
+    static const char *words[] = { "page ", "frame ", "swap ", "slot ", "fault ", "space ", "table ", "cache " };
+    static uint8_t src[PAGE_SIZE];
+    static uint8_t dst[PAGE_SIZE];
+    static uint8_t data[PAGE_SIZE * 2];
+    const char *kind = (char *)params[0];
+    const char *word = "";
+    unsigned seed = 0x2545F491;
+    for (int i = 0; i < PAGE_SIZE; ++i) {
+        seed = seed * 1103515245 + 12345;
+        if (strcmp(kind, "RANDOM") == 0) {
+            if (*word == '\0')
+                word = words[(seed >> 16) % 8];
+            src[i] = *word++;
+        } else if (strcmp(kind, "REPEAT") == 0)
+            src[i] = "kora"[i % 3];
+        else if (strcmp(kind, "NOISE") == 0)
+            src[i] = seed >> 16;
+        else
+            return cli_error("Unknown data '%s'", kind);
+    }
+
+    int length = zswap_compress(src, data, sizeof(data));
+    memset(dst, 0xa5, PAGE_SIZE);
+    if (length == 0 || zswap_decompress(data, length, dst) != 0 || memcmp(src, dst, PAGE_SIZE) != 0)
+        return cli_error("Page of %s data is not restored", kind);
+
+    bool stored = zswap_compress(src, data, ZSWAP_MAX_SIZE) != 0;
+    printf("Zswap %s: %d bytes, %d%%, %s\n", kind, length, length * 100 / PAGE_SIZE, stored ? "stored" : "rejected");
+    if (params[1] != 0 && stored != (strcmp((char *)params[1], "STORED") == 0))
+        return cli_error("Expected page of %s data to be %s", kind, (char *)params[1]);
+    return 0;
+}
+
+/* Evict a whole mapping, then time the faults bringing it back */
+static xtime_t swap_bench_run(vmsp_t *vmsp, size_t length, size_t *missing)
+{
+    size_t base = vmsp_map(vmsp, 0, length, NULL, 0, VMA_ANON | VM_RW);
+    for (size_t off = 0; off < length; off += PAGE_SIZE)
+        vmsp_resolve(vmsp, base + off, true, true);
+    page_reclaim(length / PAGE_SIZE, PGR_USPACE);
+    *missing = length / PAGE_SIZE - vmsp->w_size;
+
+    xtime_t start = xtime_read(XTIME_CLOCK);
+    for (size_t off = 0; off < length; off += PAGE_SIZE)
+        vmsp_resolve(vmsp, base + off, true, false);
+    xtime_t elapsed = xtime_read(XTIME_CLOCK) - start;
+    *missing += vmsp->w_size;
+    vmsp_unmap(vmsp, base, length);
+    return elapsed;
+}
+
+/* Compare faults on pages held by the compressed store and by the device */
+int do_swap_bench(void *ctx, size_t *params)
+{
+    size_t length = cli_read_size((char *)params[0]);
+    size_t missing = 0;
+    vmsp_t *prev = __mmu.uspace;
+    vmsp_t *vmsp = vmsp_create();
+    __mmu.uspace = vmsp;
+    xtime_t compressed = swap_bench_run(vmsp, length, &missing);
+    size_t limit = zswap_setup(0);
+    xtime_t device = swap_bench_run(vmsp, length, &missing);
+    zswap_setup(limit);
+    printf("Swap bench: %d pages, compressed faults %ld us, device faults %ld us\n",
+           (int)(length / PAGE_SIZE), (long)compressed, (long)device);
+    vmsp_close(vmsp);
+    __mmu.uspace = prev;
+    if (missing != 0)
+        return cli_error("%d pages were not swapped", (int)missing);
+    return 0;
+}
+
+/* Check the number of page faults since the last call */
+int do_faults(void *ctx, size_t *params)
+{
+    static long last = 0;
+    long count = __mmu.page_faults - last;
+    last = __mmu.page_faults;
+    printf("Page faults: %ld\n", count);
+    if (params[0] != 0 && count != (long)cli_read_size((char *)params[0]))
+        return cli_error("Expected %d page faults", (int)cli_read_size((char *)params[0]));
+    return 0;
+}
+
+int do_meminfo(void *ctx, size_t *params)
+{
+    memory_info();
+    return 0;
+}
+
 // -=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=
 
 
@@ -870,6 +1750,7 @@ cli_cmd_t __commands[] = {
     { "KMAPX", "", { ARG_STR, ARG_STR, ARG_STR, ARG_STR, ARG_STR, ARG_STR }, (void *)do_kmapx, 5 },
     { "KUNMAP", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_kunmap, 2 },
     { "KPROTECT", "", { ARG_STR, ARG_STR, ARG_STR, 0, 0, 0 }, (void *)do_kprotect, 3 },
+    { "KAREAS", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_kareas, 1 },
     { "KDLIB", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_kdlib, 1 },
     { "KSYM", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_ksym, 1 },
 
@@ -877,6 +1758,10 @@ cli_cmd_t __commands[] = {
     { "MMAPX", "", { ARG_STR, ARG_STR, ARG_STR, ARG_STR, ARG_STR, ARG_STR }, (void *)do_mmapx, 5 },
     { "MUNMAP", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_munmap, 2 },
     { "MPROTECT", "", { ARG_STR, ARG_STR, ARG_STR, 0, 0, 0 }, (void *)do_mprotect, 3 },
+    { "MADVISE", "", { ARG_STR, ARG_STR, ARG_STR, 0, 0, 0 }, (void *)do_madvise, 3 },
+    { "MAREAS", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_mareas, 1 },
+    { "MPAGES", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_mpages, 2 },
+    { "MDEFERRED", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_mdeferred, 1 },
     { "MDLIB", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_mdlib, 1 },
     { "MSYM", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_msym, 1 },
 
@@ -892,6 +1777,34 @@ cli_cmd_t __commands[] = {
     // !?
     { "MMU_READ", "", { ARG_STR, ARG_STR, ARG_STR, 0, 0, 0 }, (void *)do_mmu_read, 0 },
     { "MMU_RELEASE", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_mmu_release, 0 },
+    { "PAGE_GET", "", { ARG_STR, ARG_STR, ARG_STR, 0, 0, 0 }, (void *)do_page_get, 3 },
+    { "PAGE_NEW", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_page_new, 2 },
+    { "PAGE_CACHE", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_page_cache, 2 },
+    { "PAGE_ZERO", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_page_zero, 1 },
+    { "KMAP_ATOMIC", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_kmap_atomic, 1 },
+    { "PAGE_HOARD", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_page_hoard, 1 },
+    { "PAGE_RECLAIM", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_page_reclaim, 1 },
+    { "PAGE_WATERMARK", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_page_watermark, 2 },
+    { "PAGE_EXHAUST", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_page_exhaust, 1 },
+    { "HEAP_ARENA", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_heap_arena, 1 },
+    { "HEAP_BENCH", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_heap_bench, 2 },
+    { "KMEM_CACHE", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_kmem_cache, 2 },
+    { "MERGE_SCAN", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_merge_scan, 1 },
+    { "POPULATE_BENCH", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_populate_bench, 1 },
+    { "VMSP_BENCH", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_vmsp_bench, 1 },
+    { "HEAPSTAT", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_heapstat, 0 },
+    { "SWAPON", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_swapon, 1 },
+    { "CLONE_BENCH", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_clone_bench, 1 },
+    { "ZSWAP", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_zswap, 1 },
+    { "ZSWAP_CODEC", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_zswap_codec, 1 },
+    { "SWAP_BENCH", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_swap_bench, 1 },
+    { "SWAPOFF", "", { 0, 0, 0, 0, 0, 0 }, (void *)do_swapoff, 0 },
+    { "SWAP_SLOT", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_swap_slot, 2 },
+    { "SWAP_SHARE", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_swap_share, 2 },
+    { "SWAPPED", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_swapped, 1 },
+    { "TLBINFO", "", { ARG_STR, ARG_STR, 0, 0, 0, 0 }, (void *)do_tlbinfo, 0 },
+    { "FAULTS", "", { ARG_STR, 0, 0, 0, 0, 0 }, (void *)do_faults, 0 },
+    { "MEMINFO", "", { 0, 0, 0, 0, 0, 0 }, (void *)do_meminfo, 0 },
 
     //{ "CREATE", "", { ARG_STR, 0, 0, 0, 0 }, (void *)do_create, 0 },
     //{ "OPEN", "", { ARG_STR, 0, 0, 0, 0 }, (void *)do_open, 0 },
@@ -147,6 +147,177 @@ USPACE_CLOSE @us1
 # uspace open
 
 
+# Anonymous pages taken from the pool of zeroed pages
+PAGE_ZERO 4
+KMAP ANON 16k rw @ma8
+TOUCH @ma8 w
+TOUCH @ma8+4k w
+TOUCH @ma8+8k r
+KUNMAP @ma8 16k
+
+
+# Huge pages for large anonymous mappings
+USPACE_CREATE @us1
+MMAP ANON 8M rw @ma9
+TOUCH @ma9 w
+TOUCH @ma9+4M r
+TLBINFO
+SHOW
+MPROTECT @ma9+4k 4k r
+TLBINFO
+TOUCH @ma9+8k w
+MUNMAP @ma9 8M
+TLBINFO
+USPACE_CLOSE @us1
+
+# Ranges covering whole huge pages don't split them
+USPACE_CREATE @us1
+MMAP ANON 8M rw @ma9
+TOUCH @ma9 w
+TOUCH @ma9+4M w
+TLBINFO 2 0
+MPROTECT @ma9 8M r
+TLBINFO 2 0
+TOUCH @ma9+4M r
+MUNMAP @ma9+4M 4M
+TLBINFO 1 0
+MADVISE @ma9 4M DONTNEED
+TLBINFO 0 0
+MUNMAP @ma9 4M
+TLBINFO 0 0
+USPACE_CLOSE @us1
+
+
+# Adjacent areas with the same rights are merged
+USPACE_CREATE @us1
+MMAP ANON 8k rw @ma10
+MMAP ANON 8k rw @ma11
+MAREAS 1
+MPROTECT @ma10+4k 8k r
+MAREAS 3
+TOUCH @ma10 w
+TOUCH @ma11 r
+MPROTECT @ma10+4k 8k rw
+MAREAS 1
+TOUCH @ma10+4k w
+MUNMAP @ma10 4k
+MAREAS 1
+MUNMAP @ma10+4k 12k
+MAREAS 0
+USPACE_CLOSE @us1
+
+
+# Pages released on hint come back blank
+USPACE_CREATE @us1
+MMAP ANON 16k rw @ma12
+TOUCH @ma12 w
+TOUCH @ma12+4k w
+MADVISE @ma12 16k DONTNEED
+FAULTS
+TOUCH @ma12 w
+TOUCH @ma12+4k r
+FAULTS 2
+MUNMAP @ma12 16k
+USPACE_CLOSE @us1
+
+
+# Reads of untouched pages share the zero page until written
+USPACE_CREATE @us1
+MMAP ANON 64k rw @ma13
+TOUCH @ma13 r
+TOUCH @ma13+4k r
+TOUCH @ma13+8k r
+TOUCH @ma13+12k w
+MPAGES 1 3
+TOUCH @ma13+4k w
+MPAGES 2 2
+USPACE_CLONE @us2
+TOUCH @ma13+16k r
+MPAGES 0 5
+USPACE_CLOSE @us2
+USPACE_SELECT @us1
+MPROTECT @ma13 64k r
+MPROTECT @ma13 64k rw
+TOUCH @ma13 w
+MPAGES 1 3
+MUNMAP @ma13 64k
+MPAGES 0 0
+USPACE_CLOSE @us1
+
+
+# Identical pages of mergeable areas share a read-only frame
+USPACE_CREATE @us1
+MMAP ANON 64k rw @ma14
+TOUCH @ma14 w
+TOUCH @ma14+4k w
+TOUCH @ma14+8k w
+TOUCH @ma14+12k w
+MERGE_SCAN 0
+MERGE_SCAN 0
+MPAGES 4 0
+MADVISE @ma14 64k MERGEABLE
+MERGE_SCAN 0
+MERGE_SCAN 3
+MPAGES 0 4
+TOUCH @ma14+4k w
+MPAGES 1 3
+MADVISE @ma14 64k UNMERGEABLE
+MPAGES 4 0
+MERGE_SCAN 0
+MUNMAP @ma14 64k
+MPAGES 0 0
+USPACE_CLOSE @us1
+# The scanner goes through every user space, not only the selected one
+USPACE_CREATE @us1
+MMAP ANON 16k rw @ma14
+TOUCH @ma14 w
+TOUCH @ma14+4k w
+MADVISE @ma14 16k MERGEABLE
+USPACE_CREATE @us2
+MERGE_SCAN 0
+MERGE_SCAN 1
+USPACE_SELECT @us1
+MPAGES 0 2
+MUNMAP @ma14 16k
+USPACE_CLOSE @us1
+USPACE_SELECT @us2
+USPACE_CLOSE @us2
+
+
+# Pages of a clone are mapped on the first fault of their range
+USPACE_CREATE @us1
+MMAP ANON 64k rw @ma15
+TOUCH @ma15 w
+TOUCH @ma15+4k w
+TOUCH @ma15+8k w
+USPACE_CLONE @us2
+MPAGES 0 3
+MDEFERRED 3
+TOUCH @ma15+8k r
+MDEFERRED 0
+MPAGES 0 3
+TOUCH @ma15+4k w
+MPAGES 1 2
+USPACE_CLOSE @us2
+USPACE_SELECT @us1
+# A clone replaced right away never maps them
+USPACE_CLONE @us2
+MDEFERRED 3
+MUNMAP @ma15 64k
+MDEFERRED 0
+MPAGES 0 0
+USPACE_CLOSE @us2
+USPACE_SELECT @us1
+MUNMAP @ma15 64k
+MPAGES 0 0
+USPACE_CLOSE @us1
+CLONE_BENCH 4M
+
+
+# Populated mappings take all their faults at once
+POPULATE_BENCH 2M
+
+
 # cleanup
 DEL @ma1
 DEL @ma2
@@ -155,3 +326,11 @@ DEL @ma4
 DEL @ma5
 DEL @ma6
 DEL @ma7
+DEL @ma8
+DEL @ma9
+DEL @ma10
+DEL @ma11
+DEL @ma12
+DEL @ma13
+DEL @ma14
+DEL @ma15
@@ -54,8 +54,65 @@ USPACE_CLOSE @us1
 USPACE_SELECT @us2
 USPACE_CLOSE @us2
 
+# A read fault maps the cached neighbouring pages
+USPACE_CREATE @us1
+MMAPX FILE 20k r lorem_sm.txt 0 @mf6
+TOUCH @mf6 r
+TOUCH @mf6+4k r
+TOUCH @mf6+8k r
+TOUCH @mf6+12k r
+TOUCH @mf6+16k r
+USPACE_CLONE @us2
+FAULTS
+TOUCH @mf6+8k r
+TOUCH @mf6 r
+TOUCH @mf6+4k r
+TOUCH @mf6+12k r
+TOUCH @mf6+16k r
+FAULTS 1
+USPACE_CLOSE @us2
+USPACE_SELECT @us1
+USPACE_CLOSE @us1
+
+# Access hints drive the pages read around a fault
+USPACE_CREATE @us1
+MMAPX FILE 20k r lorem_sm.txt 0 @mf7
+MADVISE @mf7 20k SEQUENTIAL
+FAULTS
+TOUCH @mf7 r
+TOUCH @mf7+4k r
+TOUCH @mf7+8k r
+TOUCH @mf7+12k r
+TOUCH @mf7+16k r
+FAULTS 1
+MADVISE @mf7 20k DONTNEED
+MADVISE @mf7 8k RANDOM
+MAREAS 2
+TOUCH @mf7 r
+TOUCH @mf7+4k r
+TOUCH @mf7+8k r
+TOUCH @mf7+12k r
+TOUCH @mf7+16k r
+FAULTS 3
+MADVISE @mf7 20k NORMAL
+MAREAS 1
+MADVISE @mf7 20k DONTNEED
+MADVISE @mf7 20k WILLNEED
+TOUCH @mf7 r
+TOUCH @mf7+4k r
+TOUCH @mf7+8k r
+TOUCH @mf7+12k r
+TOUCH @mf7+16k r
+FAULTS 0
+USPACE_CLOSE @us1
+
+# Populated file mappings take all their faults at once
+POPULATE_BENCH 20k lorem_sm.txt
+
 DEL @mf1
 DEL @mf2
 DEL @mf3
 DEL @mf4
 DEL @mf5
+DEL @mf6
+DEL @mf7
@@ -51,3 +51,7 @@ KUNMAP @mp1 128k
 SHOW
 
 DEL @mp1
+
+# ----------------------------------------------------------------------------
+# Free slots are found without walking every area
+VMSP_BENCH 4000
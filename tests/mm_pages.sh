@@ -0,0 +1,98 @@
+ERROR ON
+# ----------------------------------------------------------------------------
+# Physical pages
+# Single pages and contiguous runs
+PAGE_GET ANY 1 @pg1
+PAGE_GET ANY 3 @pg2
+PAGE_GET ANY 64 @pg3
+PAGE_GET DMA 16 @pg4
+MEMINFO
+
+# Runs are released page by page and merged back
+MMU_RELEASE @pg2
+MMU_RELEASE @pg1
+PAGE_GET ANY 1024 @pg5
+MMU_RELEASE @pg3
+MMU_RELEASE @pg5
+MMU_RELEASE @pg4
+
+# Blocks are limited to 4 Mb
+ERROR E2BIG
+PAGE_GET ANY 1025 @pg6
+ERROR ON
+
+# Only two full 4 Mb blocks are available
+PAGE_GET ANY 1024 @pg7
+PAGE_GET ANY 1024 @pg8
+ERROR ENOMEM
+PAGE_GET ANY 1024 @pg9
+ERROR ON
+PAGE_GET ANY 512 @pg9
+MEMINFO
+MMU_RELEASE @pg7
+MMU_RELEASE @pg8
+MMU_RELEASE @pg9
+
+# Single pages go through the per-CPU caches
+PAGE_NEW 100 @pg10
+MMU_RELEASE @pg10
+ERROR EINVAL
+PAGE_CACHE 8 4
+PAGE_CACHE 8 65
+ERROR ON
+PAGE_CACHE 4 8
+PAGE_NEW 20 @pg11
+MMU_RELEASE @pg11
+MEMINFO
+PAGE_CACHE 16 48
+
+# Short-lived mappings use the per-CPU slots, and can be nested
+KMAP_ATOMIC 4
+
+# Caches give their pages back under memory pressure
+PAGE_HOARD 200
+PAGE_RECLAIM 50
+ERROR EINVAL
+PAGE_WATERMARK 64 32
+PAGE_WATERMARK 0 32
+ERROR ON
+
+# A failed allocation reclaims pages by itself
+PAGE_EXHAUST @pg12
+PAGE_NEW 100 @pg13
+MMU_RELEASE @pg13
+MMU_RELEASE @pg12
+
+# Under the low watermark, everything is reclaimed
+PAGE_WATERMARK 100000 200000
+PAGE_RECLAIM 0
+PAGE_HOARD 0
+PAGE_WATERMARK 0 0
+
+# Once nothing is left to reclaim, allocations fail instead of hanging
+USPACE_CREATE @us1
+PAGE_EXHAUST @pg14
+ERROR ENOMEM
+PAGE_NEW 1 @pg15
+MMAP ANON 16k rwa @mw1
+ERROR ON
+MMU_RELEASE @pg14
+USPACE_CLOSE @us1
+PAGE_RECLAIM 0
+
+# Slab caches hand back every page once emptied
+KMEM_CACHE 500 48
+KMEM_CACHE 40 1000
+
+# Allocation sites are sampled by the heap profiler
+HEAPSTAT 1
+KMEM_CACHE 40 1000
+HEAPSTAT
+HEAPSTAT 0
+
+# Arena allocations are served from size-class bins, resized in place
+HEAP_ARENA 5000
+
+# Heap throughput, small chunks go through the per-CPU caches
+HEAP_BENCH 1 100000
+HEAP_BENCH 4 100000
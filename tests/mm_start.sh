@@ -3,8 +3,10 @@ ERROR ON
 
 START 64M 64M 6K
 
+INCLUDE mm_pages.sh
 INCLUDE mm_misc.sh
 INCLUDE mm_anon.sh
+INCLUDE mm_swap.sh
 INCLUDE mm_heap.sh
 INCLUDE mm_file.sh
 INCLUDE mm_filecpy.sh
@@ -0,0 +1,92 @@
+ERROR ON
+# ----------------------------------------------------------------------------
+# Swap of anonymous pages
+
+SWAPON 256k
+ZSWAP 0
+USPACE_CREATE @us1
+MMAP ANON 32k rw @mw1
+TOUCH @mw1 w
+TOUCH @mw1+4k w
+TOUCH @mw1+8k w
+TOUCH @mw1+12k w
+TOUCH @mw1+16k w
+TOUCH @mw1+20k w
+
+# Pages are written out by the reclaim
+PAGE_RECLAIM 6
+SHOW
+MEMINFO
+
+# A slot counts more users than a byte holds
+SWAP_SHARE @mw1+4k 300
+
+# The first fault reads the neighbouring slots ahead
+TOUCH @mw1 r
+TOUCH @mw1+4k w
+TOUCH @mw1+24k w
+SHOW
+MEMINFO
+
+# Under pressure, a faulting task evicts pages of its own space
+PAGE_WATERMARK 100000 200000
+TOUCH @mw1+28k w
+PAGE_WATERMARK 0 0
+SWAPPED 4
+TOUCH @mw1 w
+TOUCH @mw1+4k w
+TOUCH @mw1+8k w
+TOUCH @mw1+12k w
+TOUCH @mw1+16k w
+TOUCH @mw1+20k w
+
+# Slots are shared after a clone
+PAGE_RECLAIM 4
+USPACE_CLONE @us2
+SHOW
+TOUCH @mw1+8k r
+USPACE_SELECT @us1
+MUNMAP @mw1+12k 8k
+TOUCH @mw1+8k w
+USPACE_SELECT @us2
+TOUCH @mw1+12k r
+USPACE_CLOSE @us2
+USPACE_SELECT @us1
+ERROR EBUSY
+SWAPOFF
+ERROR ON
+USPACE_CLOSE @us1
+SWAPOFF
+MEMINFO
+
+# Pages accessed since the last pass get a second chance
+SWAPON 256k
+USPACE_CREATE @us1
+MMAP ANON 16k rw @mw3
+TOUCH @mw3 w
+TOUCH @mw3+4k w
+TOUCH @mw3+8k w
+TOUCH @mw3+12k w
+PAGE_RECLAIM 1
+SWAP_SLOT @mw3 1
+TOUCH @mw3+4k r
+PAGE_RECLAIM 1
+SWAP_SLOT @mw3+4k 0
+SWAP_SLOT @mw3+8k 1
+USPACE_CLOSE @us1
+SWAPOFF
+
+# The codec restores pages, the ones too large are kept off the pool
+ZSWAP_CODEC RANDOM STORED
+ZSWAP_CODEC REPEAT STORED
+ZSWAP_CODEC NOISE REJECTED
+
+# Evicted pages are compressed in memory before going to the device
+SWAPON 1M
+ZSWAP 512k
+SWAP_BENCH 256k
+MEMINFO
+SWAPOFF
+
+DEL @mw1
+DEL @mw3
@@ -379,6 +379,18 @@ int do_rmbuf(void *cfg, size_t *params)
     return 0;
 }
 
+/* Allocate and release a packet, fill it to check its size */
+int do_skb(void *cfg, size_t *params)
+{
+    unsigned len = (unsigned)params[0];
+    skb_t *skb = net_skb_alloc(NULL, len);
+    if (skb == NULL)
+        return cli_error("Unable to allocate a packet of %d bytes", len);
+    memset(skb->buf, 0xa5, len);
+    net_skb_free(skb);
+    return 0;
+}
+
 int do_expect(void *cfg, size_t * params)
 {
     char *cmd = (char *)params[0];
@@ -605,6 +617,7 @@ cli_cmd_t __commands[] = {
     { "TEMPO", "", { 0, 0, 0, 0, 0 }, do_tempo, 1 },
     { "TEXT", "", { ARG_STR, ARG_STR, 0, 0, 0 }, do_text, 1 },
     { "RMBUF", "", { ARG_STR, 0, 0, 0, 0 }, do_rmbuf, 1 },
+    { "SKB", "", { ARG_INT, 0, 0, 0, 0 }, do_skb, 1 },
     // SOCK
     { "SOCKET", "", { ARG_STR, ARG_STR, ARG_STR, ARG_STR, 0 }, do_socket, 3 },
     { "CLOSE", "", { ARG_STR, 0, 0, 0, 0 }, do_close, 1 },
@@ -2,6 +2,10 @@
 
 ERROR ON
 
+# Packets larger than an ethernet frame are not cached
+SKB 1500
+SKB 9000
+
 NODE alice 1
 NODE bob 1
 IP4_CONFIG alice:eth:1 ip=192.168.0.1
@@ -26,6 +26,8 @@
 #include <kernel/arch.h>
 #include <kernel/vfs.h>
 #include <kernel/stdc.h>
+#include <kernel/slab.h>
+#include <kernel/kprof.h>
 #if defined(_WIN32)
 #  include <Windows.h>
 #endif
@@ -73,7 +75,10 @@ void *kalloc_(size_t len, const char *msg)
     //    ktrack_init = true;
     //}
     kallocCount++;
-    void *ptr = calloc(len, 1);
+    // Fill with garbage, callers relying on a cleared block must use kzalloc
+    void *ptr = malloc(len);
+    memset(ptr, 0xCD, len);
+    kprof_alloc(ptr, len, msg);
     //splock_lock(&ktrack_lock);
     //struct ktrack *tr = malloc(sizeof(struct ktrack));
     //assert(tr != NULL);
@@ -87,9 +92,17 @@ void *kalloc_(size_t len, const char *msg)
     return ptr;
 }
 
+void *kzalloc_(size_t len, const char *msg)
+{
+    void *ptr = kalloc_(len, msg);
+    memset(ptr, 0, len);
+    return ptr;
+}
+
 void kfree(void *ptr)
 {
     kallocCount--;
+    kprof_free(ptr);
     //splock_lock(&ktrack_lock);
     //struct ktrack *tr = bbtree_search_eq(&ktrack_tree, (size_t)ptr, struct ktrack, bnode);
     //assert(tr != NULL);
@@ -131,6 +144,7 @@ char *kstrndup(const char *str, size_t max)
 
 int alloc_check()
 {
+    kmem_sweep();
     printf("Ending session: %d alloc, %d map\n", kallocCount, kmapCount);
 
     // struct ktrack *tr = bbtree_first(&ktrack_tree, struct ktrack, bnode);
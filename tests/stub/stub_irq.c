@@ -22,6 +22,7 @@
 #include <kernel/stdc.h>
 
 thread_local int __irq_semaphore = 0;
+thread_local int __cpu_no = 0;
 
 void irq_reset(bool enable)
 {
@@ -40,7 +41,17 @@ void irq_disable()
     ++__irq_semaphore;
 }
 
+bool can_sleep(void)
+{
+    return __irq_semaphore == 0;
+}
+
 void might_sleep(void)
 {
     assert(__irq_semaphore == 0);
 }
+
+int cpu_no()
+{
+    return __cpu_no;
+}
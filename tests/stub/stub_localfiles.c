@@ -126,7 +126,7 @@ inode_t *vfs_search_ino(fs_anchor_t *fsanchor, const char *name, user_t *user, b
         return NULL;
 
     file = calloc(1, sizeof(file_t));
-    file->ino = kalloc(sizeof(inode_t));
+    file->ino = kzalloc(sizeof(inode_t));
     file->fd = fd;
     char *ptr = strrchr(name, '/');
     file->name = strdup(ptr == NULL ? name : ptr);
@@ -186,7 +186,7 @@ static void *blk_host_map_(blkmap_t *map, size_t no, int rights)
 
 static blkmap_t *blk_host_clone_(blkmap_t *map)
 {
-    blkmap_t *map2 = kalloc(sizeof(blkmap_t));
+    blkmap_t *map2 = kzalloc(sizeof(blkmap_t));
     map2->ino = map->ino;
     map2->block = map->block;
     map2->msize = map->msize;
@@ -205,7 +205,7 @@ static void blk_host_close_(blkmap_t *map)
 
 blkmap_t *blk_open(inode_t *ino, size_t blocksize)
 {
-    blkmap_t *map = kalloc(sizeof(blkmap_t));
+    blkmap_t *map = kzalloc(sizeof(blkmap_t));
     map->ino = ino;
     map->block = PAGE_SIZE;
     map->msize = PAGE_SIZE;
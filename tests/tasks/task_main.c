@@ -382,7 +382,7 @@ int do_wait(void *ctx, size_t *params)
     char *store = (char *)params[0];
     size_t timeout = params[1];
 
-    advent_t *advent = kalloc(sizeof(advent_t));
+    advent_t *advent = kzalloc(sizeof(advent_t));
     advent->wake = advent_resume_task;
     advent->dtor = __dtor_advent;
     advent->object = strdup(store);
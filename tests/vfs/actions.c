@@ -794,7 +794,7 @@ int do_tar_mount(vfs_ctx_t *ctx, size_t *param)
     len = ftell(fp);
     fseek(fp, 0, SEEK_SET);
 
-    void *buf = kalloc(ALIGN_UP(len, PAGE_SIZE));
+    void *buf = kzalloc(ALIGN_UP(len, PAGE_SIZE));
     fread(buf, len, 1, fp);
     fclose(fp);
     inode_t *ino = tar_mount(buf, len, name);
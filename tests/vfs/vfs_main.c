@@ -32,6 +32,10 @@ void page_release(page_t page)
 	page_release_kmap_stub(page);
 }
 
+void page_shrinker(int (*shrink)(int, int))
+{
+}
+
 page_t mmu_read_kmap_stub(size_t address);
 page_t mmu_read(size_t vaddr)
 {
@@ -51,7 +55,7 @@ user_t *__usr_system = NULL;
 user_t *usr_system()
 {
 	if (__usr_system == NULL) {
-		__usr_system = kalloc(sizeof(user_t));
+		__usr_system = kzalloc(sizeof(user_t));
 		for (int i = 0; i < 16; ++i)
 			__usr_system->uuid[i] = rand8();
 		__usr_system->uid = 0;